@@ -0,0 +1,275 @@
+#include "dispersal_kernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include <string>
+
+typedef std::complex<double> Complex;
+
+/*******
+ * FFT *
+ *******/
+/*
+ * In-place iterative radix-2 FFT. The size of data must be a power of 2.
+ */
+static void fft(std::vector<Complex> & data, bool inverse)
+{
+    std::size_t n (data.size());
+
+    for(std::size_t i (1), j (0); i < n; i++)
+    {
+        std::size_t bit (n >> 1);
+        for(; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if(i < j)
+            std::swap(data[i], data[j]);
+    }
+
+    for(std::size_t length (2); length <= n; length <<= 1)
+    {
+        double angle (2 * M_PI / length * (inverse ? 1 : -1));
+        Complex root (std::cos(angle), std::sin(angle));
+        for(std::size_t i (0); i < n; i += length)
+        {
+            Complex w (1);
+            for(std::size_t j (0); j < length / 2; j++)
+            {
+                Complex u (data[i + j]);
+                Complex v (data[i + j + length / 2] * w);
+                data[i + j] = u + v;
+                data[i + j + length / 2] = u - v;
+                w *= root;
+            }
+        }
+    }
+
+    if(inverse)
+        for(std::size_t i (0); i < n; i++)
+            data[i] /= static_cast<double>(n);
+}
+
+/*
+ * Convolves count contiguous lines of length values with the kernel.
+ */
+static void convolve_direct(const std::vector<float> & weights, int radius, const float * in, float * out,
+                            int count, int length)
+{
+    for(int l (0); l < count; l++)
+    {
+        const float * line_in (in + static_cast<std::size_t>(l) * length);
+        float * line_out (out + static_cast<std::size_t>(l) * length);
+        for(int i (0); i < length; i++)
+        {
+            int first (std::max(-radius, -i));
+            int last (std::min(radius, length - 1 - i));
+            float sum (0);
+            for(int j (first); j <= last; j++)
+                sum += line_in[i + j] * weights[j + radius];
+            line_out[i] = sum;
+        }
+    }
+}
+
+/*
+ * Same as convolve_direct(), as a product of spectra. Lines are zero-padded by at least the radius,
+ * so that the circular convolution does not wrap around.
+ *
+ * The kernel being real and symmetric, its spectrum is real: two lines go through each FFT, one as
+ * the real part and the other as the imaginary part, without mixing.
+ */
+static void convolve_fft(const std::vector<float> & weights, int radius, const float * in, float * out,
+                         int count, int length)
+{
+    std::size_t n (1);
+    while(n < static_cast<std::size_t>(length + radius))
+        n <<= 1;
+
+    std::vector<Complex> kernel (n);
+    for(int j (-radius); j <= radius; j++)
+        kernel[(j + n) % n] = weights[j + radius];
+    fft(kernel, false);
+
+    std::vector<Complex> lines (n);
+    for(int l (0); l < count; l += 2)
+    {
+        const float * first_in (in + static_cast<std::size_t>(l) * length);
+        const float * second_in (l + 1 < count ? first_in + length : NULL);
+
+        std::fill(lines.begin(), lines.end(), Complex(0));
+        for(int i (0); i < length; i++)
+            lines[i] = Complex(first_in[i], second_in ? second_in[i] : 0);
+
+        fft(lines, false);
+        for(std::size_t i (0); i < n; i++)
+            lines[i] *= kernel[i].real();
+        fft(lines, true);
+
+        float * first_out (out + static_cast<std::size_t>(l) * length);
+        for(int i (0); i < length; i++)
+            first_out[i] = lines[i].real();
+        if(second_in)
+            for(int i (0); i < length; i++)
+                first_out[length + i] = lines[i].imag();
+    }
+}
+
+static void transpose(const float * in, float * out, int width, int height)
+{
+    const int block (32);
+    for(int y0 (0); y0 < height; y0 += block)
+        for(int x0 (0); x0 < width; x0 += block)
+            for(int y (y0); y < std::min(y0 + block, height); y++)
+                for(int x (x0); x < std::min(x0 + block, width); x++)
+                    out[static_cast<std::size_t>(x) * height + y] = in[static_cast<std::size_t>(y) * width + x];
+}
+
+/********************
+ * DISPERSAL KERNEL *
+ ********************/
+static void check_cell_size(float cell_size)
+{
+    if(!std::isfinite(cell_size) || cell_size <= 0)
+        throw std::invalid_argument("Invalid dispersal kernel cell size: " + std::to_string(cell_size));
+}
+
+/*
+ * The quotient is checked before the cast, which is undefined beyond the int range.
+ */
+static int kernel_radius(int max_seed_distance, float cell_size)
+{
+    check_cell_size(cell_size);
+
+    double radius (static_cast<double>(max_seed_distance) / cell_size);
+    if(radius > DISPERSAL_KERNEL_MAX_RADIUS)
+        throw std::invalid_argument("Dispersal kernel radius of " + std::to_string(radius) + " cells exceeds " +
+                                    std::to_string(DISPERSAL_KERNEL_MAX_RADIUS));
+    return std::max(0, static_cast<int>(radius));
+}
+
+DispersalKernel::DispersalKernel(int p_max_seed_distance, int p_seed_count, float p_cell_size) :
+    max_seed_distance(p_max_seed_distance), seed_count(p_seed_count), cell_size(p_cell_size),
+    m_radius(kernel_radius(p_max_seed_distance, p_cell_size))
+{
+
+    if(m_radius == 0)
+    {
+        m_weights.push_back(1.f); // Seeds stay within their cell
+        return;
+    }
+
+    double sigma (m_radius / 3.);
+    double sum (0);
+    std::vector<double> weights;
+    for(int i (-m_radius); i <= m_radius; i++)
+    {
+        weights.push_back(std::exp(-(i * i) / (2 * sigma * sigma)));
+        sum += weights.back();
+    }
+
+    for(auto it (weights.begin()); it != weights.end(); it++)
+        m_weights.push_back(*it / sum);
+}
+
+int DispersalKernel::radius() const
+{
+    return m_radius;
+}
+
+const std::vector<float> & DispersalKernel::weights() const
+{
+    return m_weights;
+}
+
+void DispersalKernel::disperse(const float * sources, int width, int height, float * seeds) const
+{
+    auto convolve (m_radius > DIRECT_CONVOLUTION_MAX_RADIUS ? &convolve_fft : &convolve_direct);
+
+    // Rows, then columns as rows of the transposed raster
+    std::size_t size (static_cast<std::size_t>(width) * height);
+    std::vector<float> rows (size), columns (size);
+    convolve(m_weights, m_radius, sources, rows.data(), height, width);
+    transpose(rows.data(), columns.data(), width, height);
+    convolve(m_weights, m_radius, columns.data(), rows.data(), width, height);
+    transpose(rows.data(), seeds, height, width);
+
+    for(std::size_t i (0); i < size; i++)
+        seeds[i] *= seed_count;
+}
+
+/**************************
+ * DISPERSAL KERNEL CACHE *
+ **************************/
+DispersalKernelCache::Kernel DispersalKernelCache::get(const SpecieProperties & specie, float cell_size)
+{
+    return get(specie.specie_id, specie.seeding_properties.max_seed_distance, specie.seeding_properties.seed_count, cell_size);
+}
+
+DispersalKernelCache::Kernel DispersalKernelCache::get(const SpeciesTable & species, std::size_t specie_index, float cell_size)
+{
+    return get(species.specie_id[specie_index], species.seeding_max_seed_distance[specie_index],
+               species.seeding_seed_count[specie_index], cell_size);
+}
+
+DispersalKernelCache::Kernel DispersalKernelCache::get(int specie_id, int max_seed_distance, int seed_count, float cell_size)
+{
+    // A NaN key would break the ordering of the map
+    check_cell_size(cell_size);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // The kernel is built before being stored, so that a failure leaves no empty entry behind
+    std::pair<int, float> key (specie_id, cell_size);
+    auto it (m_kernels.find(key));
+    if(it != m_kernels.end() && it->second->max_seed_distance == max_seed_distance && it->second->seed_count == seed_count)
+        return it->second;
+
+    Kernel kernel (new DispersalKernel(max_seed_distance, seed_count, cell_size));
+    m_kernels[key] = kernel;
+
+    return kernel;
+}
+
+void DispersalKernelCache::invalidate(int specie_id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it (m_kernels.lower_bound(std::make_pair(specie_id, -INFINITY)));
+    while(it != m_kernels.end() && it->first.first == specie_id)
+        it = m_kernels.erase(it);
+}
+
+/*
+ * Updates that leave the seeding properties untouched keep the kernels.
+ */
+void DispersalKernelCache::apply(PlantDB & plant_db, int specie_id, PlantDB::ChangeType change)
+{
+    if(change == PlantDB::SPECIE_INSERTED)
+        return;
+
+    std::unique_ptr<SpecieProperties> specie;
+    if(change == PlantDB::SPECIE_UPDATED)
+        specie = plant_db.getPlantData(specie_id);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it (m_kernels.lower_bound(std::make_pair(specie_id, -INFINITY)));
+        while(it != m_kernels.end() && it->first.first == specie_id)
+        {
+            if(specie && it->second->max_seed_distance == specie->seeding_properties.max_seed_distance &&
+                    it->second->seed_count == specie->seeding_properties.seed_count)
+                it++;
+            else
+                it = m_kernels.erase(it);
+        }
+    }
+}
+
+std::size_t DispersalKernelCache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_kernels.size();
+}
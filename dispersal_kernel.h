@@ -0,0 +1,74 @@
+#ifndef DISPERSAL_KERNEL_H
+#define DISPERSAL_KERNEL_H
+
+#include "plant_db.h"
+#include "species_table.h"
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#define DIRECT_CONVOLUTION_MAX_RADIUS 48 // cells: wider kernels are applied through FFTs
+#define DISPERSAL_KERNEL_MAX_RADIUS (1 << 20) // cells
+
+/*
+ * Seed dispersal stencil of a specie at a given grid resolution: a normalized, separable Gaussian whose
+ * radius (three standard deviations) is the specie's max seed distance.
+ *
+ * max_seed_distance and cell_size must be in the same unit. The constructor throws std::invalid_argument
+ * if cell_size is not positive and finite, or if the radius exceeds DISPERSAL_KERNEL_MAX_RADIUS cells.
+ */
+class DispersalKernel {
+public:
+    DispersalKernel(int max_seed_distance, int seed_count, float cell_size);
+
+    int radius() const; // cells
+    const std::vector<float> & weights() const; // 1D weights of offsets -radius...radius, summing to 1
+
+    /*
+     * Spreads the seeds produced by sources (seed_count per unit of source, in row-major width x height
+     * rasters) to seeds. Seeds carried beyond the edges of the raster are lost.
+     */
+    void disperse(const float * sources, int width, int height, float * seeds) const;
+
+    const int max_seed_distance;
+    const int seed_count;
+    const float cell_size;
+
+private:
+    int m_radius;
+    std::vector<float> m_weights;
+};
+
+/*
+ * Dispersal kernels of species, by specie and grid resolution. A kernel is built on first use and kept
+ * until the seeding properties of its specie change: get() checks them against the cached kernel, and
+ * apply() drops the kernels of a specie whose seeding changed from a PlantDB change notification.
+ *
+ * Kernels are handed out as shared pointers so that they stay valid while being used, even if the cache
+ * drops them meanwhile. The cache can be shared between threads.
+ * get() throws std::invalid_argument, as the DispersalKernel constructor does, before caching anything.
+ */
+class DispersalKernelCache {
+public:
+    typedef std::shared_ptr<const DispersalKernel> Kernel;
+
+    Kernel get(const SpecieProperties & specie, float cell_size);
+    Kernel get(const SpeciesTable & species, std::size_t specie_index, float cell_size);
+
+    void invalidate(int specie_id);
+    void apply(PlantDB & plant_db, int specie_id, PlantDB::ChangeType change);
+
+    std::size_t size() const;
+
+private:
+    Kernel get(int specie_id, int max_seed_distance, int seed_count, float cell_size);
+
+    std::map<std::pair<int, float>, Kernel> m_kernels; // Keyed by specie id and cell size
+    mutable std::mutex m_mutex;
+};
+
+#endif // DISPERSAL_KERNEL_H
@@ -0,0 +1,104 @@
+#include "growth_curves.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+static float vigour(int age, int start_of_decline, int max_age)
+{
+    if(age >= max_age)
+        return 0.f;
+    if(age < start_of_decline)
+        return 1.f;
+    return static_cast<float>(max_age - age) / (max_age - start_of_decline);
+}
+
+// States of a specie: one every months_per_entry months before its max age, then one at its max age
+static int specie_entry_count(int max_age, int months_per_entry)
+{
+    return (max_age + months_per_entry - 1) / months_per_entry + 1;
+}
+
+static std::size_t entry_count(const SpeciesTable & species, int months_per_entry)
+{
+    std::size_t entries (0);
+    for(std::size_t i (0); i < species.size(); i++)
+        entries += specie_entry_count(std::max(0, species.ageing_max_age[i]), months_per_entry);
+    return entries;
+}
+
+GrowthCurves::GrowthCurves(const SpeciesTable & species, std::size_t memory_budget) :
+    m_months_per_entry(1)
+{
+    // Pick the finest resolution whose states, with the per specie offsets, fit in the budget. Each specie
+    // needs at least its first and max age states: there is no going coarser than the longest lifespan.
+    std::size_t months (0);
+    int longest_lifespan (1);
+    for(std::size_t i (0); i < species.size(); i++)
+    {
+        months += std::max(0, species.ageing_max_age[i]) + 1;
+        longest_lifespan = std::max(longest_lifespan, species.ageing_max_age[i]);
+    }
+
+    std::size_t specie_overhead (species.size() * (sizeof(uint64_t) + sizeof(int32_t) + sizeof(int32_t)));
+    std::size_t budget_entries (std::max<std::size_t>(1, memory_budget > specie_overhead ? (memory_budget - specie_overhead) / sizeof(GrowthState) : 0));
+    m_months_per_entry = std::min<std::size_t>(longest_lifespan, (months + budget_entries - 1) / budget_entries);
+    m_months_per_entry = std::max(1, m_months_per_entry);
+    while(m_months_per_entry < longest_lifespan && entry_count(species, m_months_per_entry) > budget_entries)
+        m_months_per_entry++;
+
+    std::size_t entries (entry_count(species, m_months_per_entry));
+    if(specie_overhead + entries * sizeof(GrowthState) > memory_budget)
+        throw std::invalid_argument("Growth curves memory budget of " + std::to_string(memory_budget) + " bytes is too small for " +
+                                    std::to_string(species.size()) + " species: at least " +
+                                    std::to_string(specie_overhead + entries * sizeof(GrowthState)) + " bytes are needed");
+
+    m_states.reserve(entries);
+    m_offsets.reserve(species.size());
+    m_max_ages.reserve(species.size());
+    m_last_entries.reserve(species.size());
+    for(std::size_t i (0); i < species.size(); i++)
+    {
+        int max_age (std::max(0, species.ageing_max_age[i]));
+        int start_of_decline (species.ageing_start_of_decline[i]);
+
+        m_offsets.push_back(m_states.size());
+        m_max_ages.push_back(max_age);
+        m_last_entries.push_back(specie_entry_count(max_age, m_months_per_entry) - 1);
+
+        GrowthState state;
+        state.height = state.canopy_width = state.root_size = 0.f;
+        for(int age (0); age <= max_age; age++)
+        {
+            state.vigour = vigour(age, start_of_decline, max_age);
+            if(age == max_age || age % m_months_per_entry == 0)
+                m_states.push_back(state);
+
+            state.height += species.growth_max_height[i] * state.vigour;
+            state.canopy_width += species.growth_max_canopy_width[i] * state.vigour;
+            state.root_size += species.growth_max_root_size[i] * state.vigour;
+        }
+    }
+}
+
+std::size_t GrowthCurves::size() const
+{
+    return m_offsets.size();
+}
+
+const GrowthState & GrowthCurves::state(std::size_t specie_index, int age) const
+{
+    int entry (age >= m_max_ages[specie_index] ? m_last_entries[specie_index] : std::max(0, age) / m_months_per_entry);
+    return m_states[m_offsets[specie_index] + entry];
+}
+
+int GrowthCurves::monthsPerEntry() const
+{
+    return m_months_per_entry;
+}
+
+std::size_t GrowthCurves::memoryUsage() const
+{
+    return m_states.capacity() * sizeof(GrowthState) + m_offsets.capacity() * sizeof(uint64_t) +
+            (m_max_ages.capacity() + m_last_entries.capacity()) * sizeof(int32_t);
+}
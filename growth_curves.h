@@ -0,0 +1,53 @@
+#ifndef GROWTH_CURVES_H
+#define GROWTH_CURVES_H
+
+#include "species_table.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#define DEFAULT_GROWTH_CURVES_MEMORY_BUDGET (64 * 1024 * 1024) // bytes
+
+/*
+ * State of a plant of a given specie and age.
+ */
+struct GrowthState {
+    float height; // cm
+    float canopy_width; // cm
+    float root_size; // cm
+    float vigour; // 1 until the start of decline, falling linearly to 0 at max age
+
+    float mortality() const { return 1.f - vigour; } // Chance of dying within the month
+};
+
+/*
+ * Growth and ageing of every specie of a SpeciesTable, precomputed for every age up to its max age.
+ *
+ * A plant grows by its specie's growth rates (cm per month) scaled by its vigour, so growth slows down
+ * once the plant starts declining. The states of a specie are stored contiguously: looking a plant up
+ * is a single indexed load. Past its max age, a plant keeps the state of its max age, with no vigour.
+ *
+ * Tables are kept within the memory budget, per specie offsets included, by storing one state every
+ * monthsPerEntry() months (1 unless the species live too long for the budget) plus the state at max age;
+ * ages in between get the state of the entry below. Every specie needs at least its first and max age
+ * states: the constructor throws std::invalid_argument if even those do not fit in the budget.
+ */
+class GrowthCurves {
+public:
+    GrowthCurves(const SpeciesTable & species, std::size_t memory_budget = DEFAULT_GROWTH_CURVES_MEMORY_BUDGET);
+
+    std::size_t size() const;
+    const GrowthState & state(std::size_t specie_index, int age) const; // age in months
+
+    int monthsPerEntry() const;
+    std::size_t memoryUsage() const; // Bytes used by the tables
+
+private:
+    int m_months_per_entry;
+    SpeciesTable::Column<GrowthState> m_states;
+    SpeciesTable::Column<uint64_t> m_offsets; // First state of each specie
+    SpeciesTable::Column<int32_t> m_max_ages;
+    SpeciesTable::Column<int32_t> m_last_entries; // Index of the max age state of each specie, from its first
+};
+
+#endif // GROWTH_CURVES_H
@@ -2,124 +2,347 @@
 #include "settings.h"
 
 #include <QString>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <thread>
 
-PlantDB::PlantDB()
+#define BUSY_TIMEOUT 5000 // ms to wait for a lock held by another connection before giving up
+#define BULK_LOAD_CACHE_SIZE 262144 // KiB of page cache in bulk load mode
+#define SCHEMA_VERSION 2 // Stored as the user_version of the db. Increment whenever the tables or indexes change
+#define READ_ONLY_MMAP_SIZE 1073741824 // Bytes of the db file memory-mapped in read-only modes
+#define BUSY_RETRIES 5 // Retries of a busy or locked statement, on top of the busy timeout
+#define BUSY_RETRY_BACKOFF 10 // ms before the first retry, doubled after each of them
+
+PlantDBException::PlantDBException(int code, int line, const std::string & message) :
+    std::runtime_error(message), m_code(code), m_line(line)
+{
+
+}
+
+int PlantDBException::code() const
+{
+    return m_code;
+}
+
+int PlantDBException::line() const
+{
+    return m_line;
+}
+
+bool PlantDBException::busy() const
+{
+    return (m_code & 0xff) == SQLITE_BUSY || (m_code & 0xff) == SQLITE_LOCKED;
+}
+
+PlantDB::PlantDB(int open_flags) :
+    PlantDB(Settings::db_file(), open_flags)
+{
+
+}
+
+PlantDB::PlantDB(const std::string & db_file, int open_flags) :
+    m_db_file(db_file),
+    m_open_flags(open_flags),
+    m_db(open_db()),
+    m_instrumented(false),
+    m_next_subscription_id(0)
+{
+    try
+    {
+        init();
+    }
+    catch(...)
+    {
+        // The destructor does not run for a partially constructed PlantDB
+        finalize_statements();
+        sqlite3_close(m_db);
+        throw;
+    }
+
+    sqlite3_update_hook(m_db, &PlantDB::update_hook, this);
+    sqlite3_rollback_hook(m_db, &PlantDB::rollback_hook, this);
+}
+
+PlantDB::~PlantDB()
 {
-    init();
+    finalize_statements();
+    sqlite3_close(m_db);
 }
 
 /****************************
  * OPEN DATABASE CONNECTION *
  ****************************/
+/*
+ * Percent-encodes the characters which have a meaning in a URI filename (see https://www.sqlite.org/uri.html)
+ */
+static std::string file_uri(const std::string & path)
+{
+    static const char hex_digits[] = "0123456789ABCDEF";
+
+    std::string uri ("file:");
+    for(auto it (path.begin()); it != path.end(); it++)
+    {
+        if(*it == '%' || *it == '?' || *it == '#')
+            uri += std::string("%") + hex_digits[(*it >> 4) & 0xf] + hex_digits[*it & 0xf];
+        else
+            uri += *it;
+    }
+    return uri;
+}
+
+/*
+ * In the read-only modes the db is opened without write access. IMMUTABLE_MODE also tells sqlite that the file
+ * cannot change: it then takes no lock at all, which saves a round-trip to the server per transaction on
+ * network filesystems. Reads go through a memory map rather than read() calls.
+ */
 sqlite3 * PlantDB::open_db()
 {
-    sqlite3 * db;
-    exit_on_error ( sqlite3_open(Settings::_DB_FILE.c_str(), &db), __LINE__, "" );
-    exit_on_error( sqlite3_exec(db, "PRAGMA foreign_keys = ON;", 0, 0, 0), __LINE__);
+    // Without a journal, the rollback of a failed mutation in EXCEPTION_MODE would leave the db corrupt
+    if((m_open_flags & BULK_LOAD_MODE) && (m_open_flags & EXCEPTION_MODE))
+        exit_on_error(SQLITE_MISUSE, __LINE__, sqlite3_mprintf("BULK_LOAD_MODE cannot be combined with EXCEPTION_MODE"));
+
+    sqlite3 * db (NULL);
+    try
+    {
+        if(m_open_flags & IMMUTABLE_MODE)
+            exit_on_error( sqlite3_open_v2((file_uri(m_db_file) + "?immutable=1").c_str(), &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_URI, NULL), __LINE__);
+        else if(m_open_flags & READ_ONLY_MODE)
+            exit_on_error( sqlite3_open_v2(m_db_file.c_str(), &db, SQLITE_OPEN_READONLY, NULL), __LINE__);
+        else
+            exit_on_error( sqlite3_open(m_db_file.c_str(), &db), __LINE__);
+        exit_on_error( sqlite3_exec(db, "PRAGMA foreign_keys = ON;", 0, 0, 0), __LINE__);
+
+        if(readOnly())
+            exit_on_error( sqlite3_exec(db, ("PRAGMA mmap_size = " + std::to_string(READ_ONLY_MMAP_SIZE) + ";").c_str(), 0, 0, 0), __LINE__);
+
+        // Wait for concurrent connections to release their locks rather than failing straight away with SQLITE_BUSY
+        exit_on_error( sqlite3_busy_timeout(db, BUSY_TIMEOUT), __LINE__);
+
+        if((m_open_flags & WAL_MODE) && !readOnly())
+        {
+            // Readers and the writer no longer block each other. The journal mode is persisted in the db file.
+            exit_on_error( sqlite3_exec(db, "PRAGMA journal_mode = WAL;", 0, 0, 0), __LINE__);
+            exit_on_error( sqlite3_exec(db, "PRAGMA synchronous = NORMAL;", 0, 0, 0), __LINE__);
+        }
+
+        if((m_open_flags & BULK_LOAD_MODE) && !readOnly())
+        {
+            // Inserts are bound by the B-tree work: drop everything else. Ids are generated by the db, so the
+            // foreign keys of the property rows are valid anyway.
+            exit_on_error( sqlite3_exec(db, "PRAGMA foreign_keys = OFF;", 0, 0, 0), __LINE__);
+            exit_on_error( sqlite3_exec(db, "PRAGMA journal_mode = OFF;", 0, 0, 0), __LINE__);
+            exit_on_error( sqlite3_exec(db, "PRAGMA synchronous = OFF;", 0, 0, 0), __LINE__);
+            exit_on_error( sqlite3_exec(db, ("PRAGMA cache_size = -" + std::to_string(BULK_LOAD_CACHE_SIZE) + ";").c_str(), 0, 0, 0), __LINE__);
+        }
+    }
+    catch(...)
+    {
+        sqlite3_close(db);
+        throw;
+    }
+
     return db;
 }
 
+/*
+ * Creates any missing table or index. Indexes are created with IF NOT EXISTS, which also migrates
+ * databases created before they were introduced: the property tables reference species through
+ * their _id column, which is otherwise unindexed and makes every update and cascading delete
+ * scan the whole table. The envelope indexes (min and max of each condition) let
+ * getPlantDataTolerating search the most selective condition instead of scanning every specie.
+ * The schema version is stored in the db once done, so that opening an up to date db only reads it.
+ */
 void PlantDB::init()
 {
+    // A read-only db is used as is: reads work as long as its tables exist
+    if(readOnly() || schema_version() >= SCHEMA_VERSION)
+        return;
+
+    Transaction transaction (*this);
     char *error_msg = 0;
-    sqlite3 * db (open_db());
 
     // Specie Table
-    int rc (sqlite3_exec(db, specie_table_creation_code.c_str(), NULL, 0, &error_msg));
+    int rc (sqlite3_exec(m_db, specie_table_creation_code.c_str(), NULL, 0, &error_msg));
     exit_on_error ( rc, __LINE__, error_msg );
 
     // growth properties table
-    rc = sqlite3_exec(db, growth_properties_table_creation_code.c_str(), NULL, 0, &error_msg);
+    rc = sqlite3_exec(m_db, growth_properties_table_creation_code.c_str(), NULL, 0, &error_msg);
+    exit_on_error ( rc, __LINE__, error_msg );
+    rc = sqlite3_exec(m_db, growth_properties_table_id_index_creation_code.c_str(), NULL, 0, &error_msg);
     exit_on_error ( rc, __LINE__, error_msg );
 
     // illumination properties table
-    rc = sqlite3_exec(db, illumination_properties_table_creation_code.c_str(), NULL, 0, &error_msg);
+    rc = sqlite3_exec(m_db, illumination_properties_table_creation_code.c_str(), NULL, 0, &error_msg);
+    exit_on_error ( rc, __LINE__, error_msg );
+    rc = sqlite3_exec(m_db, illumination_properties_table_id_index_creation_code.c_str(), NULL, 0, &error_msg);
+    exit_on_error ( rc, __LINE__, error_msg );
+    rc = sqlite3_exec(m_db, illumination_properties_table_envelope_index_creation_code.c_str(), NULL, 0, &error_msg);
     exit_on_error ( rc, __LINE__, error_msg );
 
     // Ageing properties table
-    rc = sqlite3_exec(db, ageing_properties_table_creation_code.c_str(), NULL, 0, &error_msg);
+    rc = sqlite3_exec(m_db, ageing_properties_table_creation_code.c_str(), NULL, 0, &error_msg);
+    exit_on_error ( rc, __LINE__, error_msg );
+    rc = sqlite3_exec(m_db, ageing_properties_table_id_index_creation_code.c_str(), NULL, 0, &error_msg);
     exit_on_error ( rc, __LINE__, error_msg );
 
     // Soil Humidity properties table
-    rc = sqlite3_exec(db, soil_humidity_properties_table_creation_code.c_str(), NULL, 0, &error_msg);
+    rc = sqlite3_exec(m_db, soil_humidity_properties_table_creation_code.c_str(), NULL, 0, &error_msg);
+    exit_on_error ( rc, __LINE__, error_msg );
+    rc = sqlite3_exec(m_db, soil_humidity_properties_table_id_index_creation_code.c_str(), NULL, 0, &error_msg);
+    exit_on_error ( rc, __LINE__, error_msg );
+    rc = sqlite3_exec(m_db, soil_humidity_properties_table_envelope_index_creation_code.c_str(), NULL, 0, &error_msg);
     exit_on_error ( rc, __LINE__, error_msg );
 
     // Seeding properties table
-    rc = sqlite3_exec(db, seeding_properties_table_creation_code.c_str(), NULL, 0, &error_msg);
+    rc = sqlite3_exec(m_db, seeding_properties_table_creation_code.c_str(), NULL, 0, &error_msg);
+    exit_on_error ( rc, __LINE__, error_msg );
+    rc = sqlite3_exec(m_db, seeding_properties_table_id_index_creation_code.c_str(), NULL, 0, &error_msg);
     exit_on_error ( rc, __LINE__, error_msg );
 
     // temperature properties table
-    rc = sqlite3_exec(db, temperature_properties_table_creation_code.c_str(), NULL, 0, &error_msg);
+    rc = sqlite3_exec(m_db, temperature_properties_table_creation_code.c_str(), NULL, 0, &error_msg);
+    exit_on_error ( rc, __LINE__, error_msg );
+    rc = sqlite3_exec(m_db, temperature_properties_table_id_index_creation_code.c_str(), NULL, 0, &error_msg);
+    exit_on_error ( rc, __LINE__, error_msg );
+    rc = sqlite3_exec(m_db, temperature_properties_table_envelope_index_creation_code.c_str(), NULL, 0, &error_msg);
     exit_on_error ( rc, __LINE__, error_msg );
 
     // slope properties table
-    rc = sqlite3_exec(db, slope_properties_table_creation_code.c_str(), NULL, 0, &error_msg);
+    rc = sqlite3_exec(m_db, slope_properties_table_creation_code.c_str(), NULL, 0, &error_msg);
     exit_on_error ( rc, __LINE__, error_msg );
+    rc = sqlite3_exec(m_db, slope_properties_table_id_index_creation_code.c_str(), NULL, 0, &error_msg);
+    exit_on_error ( rc, __LINE__, error_msg );
+    rc = sqlite3_exec(m_db, slope_properties_table_max_index_creation_code.c_str(), NULL, 0, &error_msg);
+    exit_on_error ( rc, __LINE__, error_msg );
+
+    // Specie name index (lookups by name)
+    rc = sqlite3_exec(m_db, specie_table_name_index_creation_code.c_str(), NULL, 0, &error_msg);
+    exit_on_error ( rc, __LINE__, error_msg );
+
+    rc = sqlite3_exec(m_db, ("PRAGMA user_version = " + std::to_string(SCHEMA_VERSION) + ";").c_str(), NULL, 0, &error_msg);
+    exit_on_error ( rc, __LINE__, error_msg );
+
+    transaction.commit();
+}
+
+int PlantDB::schema_version()
+{
+    static const std::string sql = "PRAGMA user_version;";
+
+    sqlite3_stmt * statement (get_statement(sql, __func__));
 
-    sqlite3_close(db);
+    int rc (step_statement(statement));
+    if(rc != SQLITE_ROW)
+        exit_on_error(rc, __LINE__);
+    int schema_version (sqlite3_column_int(statement, 0));
 
-    std::cout << "All database tables created successfully!" << std::endl;
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
+
+    return schema_version;
 }
 
 /****************************
  * INTERFACE WITH THE WORLD *
  ****************************/
-PlantDB::SpeciePropertiesHolder PlantDB::getAllPlantData()
+PlantDB::SpeciePropertiesHolder PlantDB::getAllPlantData() const
 {
     PlantDB::SpeciePropertiesHolder ret;
 
-    std::map<int, QString> specie_ids(get_all_species());
-    std::map<int, AgeingProperties> ageing_properties(get_all_ageing_properties());
-    std::map<int, GrowthProperties> growth_properties(get_all_growth_properties());
-    std::map<int, IlluminationProperties> illumination_properties(get_all_illumination_properties());
-    std::map<int, SoilHumidityProperties> soil_humidity_properties(get_all_soil_humidity_properties());
-    std::map<int, SeedingProperties> seeding_properties(get_all_seeding_properties());
-    std::map<int, TemperatureProperties> temperature_properties(get_all_temp_properties());
-    std::map<int, SlopeProperties> slope_properties(get_all_slope_properties());
+    static const std::string sql = plant_data_select_code() + ";";
+
+    read_all_plant_data(get_statement(sql, __func__), ret);
+
+    return ret;
+}
+
+std::unique_ptr<SpecieProperties> PlantDB::getPlantData(int id) const
+{
+    static const std::string sql = plant_data_select_code() +
+            " WHERE " + specie_table_name + "." + column_id.name + " = ?;";
+
+    sqlite3_stmt * statement (get_statement(sql, "getPlantData(id)"));
+    exit_on_error(sqlite3_bind_int(statement, 1, id), __LINE__);
+
+    std::unique_ptr<SpecieProperties> ret;
+
+    int rc (step_statement(statement));
+    if(rc == SQLITE_ROW)
+        ret.reset(new SpecieProperties(read_plant_data(statement)));
+    else
+        exit_on_error(rc, __LINE__);
 
-    for(auto it (specie_ids.begin()); it != specie_ids.end(); it++)
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
+
+    return ret;
+}
+
+#define PLANT_DATA_LOOKUP_BATCH_SIZE 256
+PlantDB::SpeciePropertiesHolder PlantDB::getPlantData(const std::vector<int> & ids) const
+{
+    // The ids are looked up in batches through a single statement. The last batch is padded by repeating its last id.
+    static const std::string sql = [](){
+        std::string sql (plant_data_select_code() + " WHERE " + specie_table_name + "." + column_id.name + " IN (?");
+        for(int i (1); i < PLANT_DATA_LOOKUP_BATCH_SIZE; i++)
+            sql += ",?";
+        return sql + ");";
+    }();
+
+    PlantDB::SpeciePropertiesHolder ret;
+
+    for(std::size_t batch_start (0); batch_start < ids.size(); batch_start += PLANT_DATA_LOOKUP_BATCH_SIZE)
     {
-        int id(it->first);
-        QString name(it->second);
-        AgeingProperties ageing_property(ageing_properties.find(id)->second);
-        GrowthProperties growth_property(growth_properties.find(id)->second);
-        IlluminationProperties illumination_property(illumination_properties.find(id)->second);
-        SoilHumidityProperties soil_humidity_property(soil_humidity_properties.find(id)->second);
-        TemperatureProperties temperature_property(temperature_properties.find(id)->second);
-        SeedingProperties seeding_property(seeding_properties.find(id)->second);
-        SlopeProperties slope_property(slope_properties.find(id)->second);
-
-        SpecieProperties sp(name,
-                            id,
-                            ageing_property,
-                            growth_property,
-                            illumination_property,
-                            soil_humidity_property,
-                            temperature_property,
-                            seeding_property,
-                            slope_property);
-
-        ret.emplace(id,sp);
+        sqlite3_stmt * statement (get_statement(sql, "getPlantData(ids)"));
+
+        for(std::size_t i (0); i < PLANT_DATA_LOOKUP_BATCH_SIZE; i++)
+        {
+            int id (ids[std::min(batch_start + i, ids.size()-1)]);
+            exit_on_error(sqlite3_bind_int(statement, i+1, id), __LINE__);
+        }
+
+        read_all_plant_data(statement, ret);
     }
 
     return ret;
 }
 
+PlantDB::SpeciePropertiesHolder PlantDB::getPlantDataByName(const QString & name) const
+{
+    static const std::string sql = plant_data_select_code() +
+            " WHERE " + specie_table_name + "." + specie_table_column_specie_name.name + " = ?;";
+
+    sqlite3_stmt * statement (get_statement(sql, __func__));
+
+    QByteArray name_byte_array ( name.toUtf8());
+    const char* name_c_string ( name_byte_array.constData());
+    exit_on_error(sqlite3_bind_text(statement, 1, name_c_string, -1/*null-terminated*/, NULL), __LINE__);
+
+    PlantDB::SpeciePropertiesHolder ret;
+    read_all_plant_data(statement, ret);
+
+    return ret;
+}
+
 void PlantDB::insertNewPlantData(SpecieProperties & data)
 {
-    data.specie_id = insert_plant(data.specie_name);
-    insert_ageing_properties(data.specie_id, data.ageing_properties);
-    insert_growth_properties(data.specie_id, data.growth_properties);
-    insert_illumination_properties(data.specie_id, data.illumination_properties);
-    insert_soil_humidity_properties(data.specie_id, data.soil_humidity_properties);
-    insert_seeding_properties(data.specie_id, data.seeding_properties);
-    insert_temp_properties(data.specie_id, data.temperature_properties);
-    insert_slope_properties(data.specie_id, data.slope_properties);
+    Transaction transaction (*this);
+    insert_plant_data(data);
+    transaction.commit();
+}
+
+void PlantDB::insertNewPlantData(std::vector<SpecieProperties> & data)
+{
+    Transaction transaction (*this);
+    for(auto it (data.begin()); it != data.end(); it++)
+        insert_plant_data(*it);
+    transaction.commit();
 }
 
 void PlantDB::updatePlantData(const SpecieProperties & data)
 {
+    Transaction transaction (*this);
     update_specie_name(data.specie_id, data.specie_name);
     update_ageing_properties(data.specie_id, data.ageing_properties);
     update_growth_properties(data.specie_id, data.growth_properties);
@@ -128,380 +351,226 @@ void PlantDB::updatePlantData(const SpecieProperties & data)
     update_seeding_properties(data.specie_id, data.seeding_properties);
     update_temp_properties(data.specie_id, data.temperature_properties);
     update_slope_properties(data.specie_id, data.slope_properties);
+    transaction.commit();
 }
 
 void PlantDB::removePlant(int p_id)
 {
+    Transaction transaction (*this);
     delete_plant(p_id);
+    transaction.commit();
 }
 
-/*********************
- * SELECT STATEMENTS *
- *********************/
-std::map<int,QString> PlantDB::get_all_species()
+bool PlantDB::readOnly() const
 {
-    sqlite3 * db (open_db());
-    char * error_msg = 0;
-    sqlite3_stmt * statement;
-
-    static const std::string sql = "SELECT * FROM " + specie_table_name + ";";
+    return m_open_flags & (READ_ONLY_MODE | IMMUTABLE_MODE);
+}
 
-    std::map<int, QString> specie_id_to_name;
+int PlantDB::dataVersion() const
+{
+    static const std::string sql = "PRAGMA data_version;";
 
-    // Prepare the statement
-    int rc (sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL));
-    exit_on_error(rc, __LINE__, error_msg);
+    sqlite3_stmt * statement (get_statement(sql, __func__));
 
-    while(sqlite3_step(statement) == SQLITE_ROW)
-    {
-        int id;
-        const char * plant_name;
-
-        for(int c (0); c < sqlite3_column_count(statement); c++)
-        {
-            if(c == column_id.index)
-                id = sqlite3_column_int(statement,c);
-            else if(c == specie_table_column_specie_name.index)
-                plant_name = reinterpret_cast<const char*>(sqlite3_column_text(statement,c));
-            else
-            {
-                std::cerr << "Unknown column: " << sqlite3_column_name(statement,c) <<
-                             " in file " << __FILE__ << " and line " << __LINE__ << std::endl;
-                exit(1);
-            }
-        }
-        specie_id_to_name.insert(std::pair<int,QString>(id, QString(plant_name)));
-    }
+    int rc (step_statement(statement));
+    if(rc != SQLITE_ROW)
+        exit_on_error(rc, __LINE__);
+    int data_version (sqlite3_column_int(statement, 0));
 
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
 
-    return specie_id_to_name;
+    return data_version;
 }
 
-std::map<int, AgeingProperties> PlantDB::get_all_ageing_properties()
+/*********************
+ * SELECT STATEMENTS *
+ *********************/
+static std::string qualified_column_name(const std::string & table_name, const Column & column)
 {
-    sqlite3 * db (open_db());
-    char * error_msg = 0;
-    sqlite3_stmt * statement;
-
-    static const std::string sql = "SELECT * FROM " + ageing_properties_table_name + ";";
-
-    std::map<int, AgeingProperties> ret;
+    return table_name + "." + column.name;
+}
 
-    // Prepare the statement
-    int rc (sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL));
-    exit_on_error(rc, __LINE__, error_msg);
+/*
+ * Selects every property of a specie in a single row by joining the specie table with
+ * each of the property tables. Column order matches the decoding in read_plant_data().
+ */
+const std::string & PlantDB::plant_data_select_code()
+{
+    static const std::string sql = "SELECT " +
+            qualified_column_name(specie_table_name, column_id) + "," +
+            qualified_column_name(specie_table_name, specie_table_column_specie_name) + "," +
+            qualified_column_name(ageing_properties_table_name, ageing_properties_table_column_start_of_decline) + "," +
+            qualified_column_name(ageing_properties_table_name, ageing_properties_table_column_max_age) + "," +
+            qualified_column_name(growth_properties_table_name, growth_properties_table_column_max_height) + "," +
+            qualified_column_name(growth_properties_table_name, growth_properties_table_column_max_root_size) + "," +
+            qualified_column_name(growth_properties_table_name, growth_properties_table_column_max_canopy_width) + "," +
+            qualified_column_name(illumination_properties_table_name, illumination_properties_table_column_prime_start) + "," +
+            qualified_column_name(illumination_properties_table_name, illumination_properties_table_column_prime_end) + "," +
+            qualified_column_name(illumination_properties_table_name, illumination_properties_table_column_min) + "," +
+            qualified_column_name(illumination_properties_table_name, illumination_properties_table_column_max) + "," +
+            qualified_column_name(soil_humidity_properties_table_name, soil_humidity_properties_table_column_prime_start) + "," +
+            qualified_column_name(soil_humidity_properties_table_name, soil_humidity_properties_table_column_prime_end) + "," +
+            qualified_column_name(soil_humidity_properties_table_name, soil_humidity_properties_table_column_min) + "," +
+            qualified_column_name(soil_humidity_properties_table_name, soil_humidity_properties_table_column_max) + "," +
+            qualified_column_name(temperature_properties_table_name, temperature_properties_table_column_prime_start) + "," +
+            qualified_column_name(temperature_properties_table_name, temperature_properties_table_column_prime_end) + "," +
+            qualified_column_name(temperature_properties_table_name, temperature_properties_table_column_min) + "," +
+            qualified_column_name(temperature_properties_table_name, temperature_properties_table_column_max) + "," +
+            qualified_column_name(seeding_properties_table_name, seeding_properties_table_column_max_seeding_distance) + "," +
+            qualified_column_name(seeding_properties_table_name, seeding_properties_table_column_seed_count) + "," +
+            qualified_column_name(slope_properties_table_name, slope_properties_table_column_start_of_decline) + "," +
+            qualified_column_name(slope_properties_table_name, slope_properties_table_column_max) +
+            " FROM " + specie_table_name +
+            " INNER JOIN " + ageing_properties_table_name + " USING (" + column_id.name + ")" +
+            " INNER JOIN " + growth_properties_table_name + " USING (" + column_id.name + ")" +
+            " INNER JOIN " + illumination_properties_table_name + " USING (" + column_id.name + ")" +
+            " INNER JOIN " + soil_humidity_properties_table_name + " USING (" + column_id.name + ")" +
+            " INNER JOIN " + temperature_properties_table_name + " USING (" + column_id.name + ")" +
+            " INNER JOIN " + seeding_properties_table_name + " USING (" + column_id.name + ")" +
+            " INNER JOIN " + slope_properties_table_name + " USING (" + column_id.name + ")";
+
+    return sql;
+}
 
-    while(sqlite3_step(statement) == SQLITE_ROW)
+void PlantDB::read_all_plant_data(sqlite3_stmt * statement, SpeciePropertiesHolder & out) const
+{
+    int rc;
+    while((rc = step_statement(statement)) == SQLITE_ROW)
     {
-        int id;
-        int start_of_decline;
-        int max_age;
-
-        for(int c (0); c < sqlite3_column_count(statement); c++)
-        {
-            if(c == column_id.index)
-                id = sqlite3_column_int(statement,c);
-            else if(c == ageing_properties_table_column_start_of_decline.index)
-                start_of_decline = sqlite3_column_int(statement,c);
-            else if(c == ageing_properties_table_column_max_age.index)
-                max_age = sqlite3_column_int(statement,c);
-            else
-            {
-                std::cerr << "Unknown column: " << sqlite3_column_name(statement,c) <<
-                             " in file " << __FILE__ << " and line " << __LINE__ << std::endl;
-                exit(1);
-            }
-        }
-        ret.emplace(id, AgeingProperties(start_of_decline, max_age));
+        SpecieProperties sp(read_plant_data(statement));
+        out.emplace(sp.specie_id, sp);
     }
+    exit_on_error(rc, __LINE__);
 
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
-
-    return ret;
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
 }
 
-std::map<int, GrowthProperties> PlantDB::get_all_growth_properties()
+SpecieProperties PlantDB::read_plant_data(sqlite3_stmt * statement) const
 {
-    sqlite3 * db (open_db());
-    char * error_msg = 0;
-    sqlite3_stmt * statement;
-
-    static const std::string sql = "SELECT * FROM " + growth_properties_table_name + ";";
+    int c (0);
 
-    std::map<int, GrowthProperties> ret;
+    int id (sqlite3_column_int(statement, c++));
+    QString name (reinterpret_cast<const char*>(sqlite3_column_text(statement, c++)));
 
-    // Prepare the statement
-    int rc (sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL));
-    exit_on_error(rc, __LINE__, error_msg);
-
-    while(sqlite3_step(statement) == SQLITE_ROW)
-    {
-        int id;
-        float max_height; // cm per month
-        float max_root_size; // cm per month
-        float max_canopy_width; // cm per month
-
-        for(int c (0); c < sqlite3_column_count(statement); c++)
-        {
-            if(c == column_id.index)
-                id = sqlite3_column_int(statement,c);
-            else if(c == growth_properties_table_column_max_height.index)
-                max_height = sqlite3_column_double(statement,c);
-            else if(c == growth_properties_table_column_max_canopy_width.index)
-                max_canopy_width = sqlite3_column_double(statement,c);
-            else if(c == growth_properties_table_column_max_root_size.index)
-                max_root_size = sqlite3_column_double(statement,c);
-            else
-            {
-                std::cerr << "Unknown column: " << sqlite3_column_name(statement,c) <<
-                             " in file " << __FILE__ << " and line " << __LINE__ << std::endl;
-                exit(1);
-            }
-        }
-        ret.emplace(id, GrowthProperties(max_height, max_root_size, max_canopy_width));
-    }
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+    int ageing_start_of_decline (sqlite3_column_int(statement, c++));
+    int ageing_max_age (sqlite3_column_int(statement, c++));
 
-    return ret;
-}
+    float growth_max_height (sqlite3_column_double(statement, c++));
+    float growth_max_root_size (sqlite3_column_double(statement, c++));
+    float growth_max_canopy_width (sqlite3_column_double(statement, c++));
 
-std::map<int, IlluminationProperties> PlantDB::get_all_illumination_properties()
-{
-    sqlite3 * db (open_db());
-    char * error_msg = 0;
-    sqlite3_stmt * statement;
+    int illumination_prime_start (sqlite3_column_int(statement, c++));
+    int illumination_prime_end (sqlite3_column_int(statement, c++));
+    int illumination_min (sqlite3_column_int(statement, c++));
+    int illumination_max (sqlite3_column_int(statement, c++));
 
-    static const std::string sql = "SELECT * FROM " + illumination_properties_table_name + ";";
+    int soil_humidity_prime_start (sqlite3_column_int(statement, c++));
+    int soil_humidity_prime_end (sqlite3_column_int(statement, c++));
+    int soil_humidity_min (sqlite3_column_int(statement, c++));
+    int soil_humidity_max (sqlite3_column_int(statement, c++));
 
-    std::map<int,IlluminationProperties> ret;
+    int temp_prime_start (sqlite3_column_int(statement, c++));
+    int temp_prime_end (sqlite3_column_int(statement, c++));
+    int temp_min (sqlite3_column_int(statement, c++));
+    int temp_max (sqlite3_column_int(statement, c++));
 
-    // Prepare the statement
-    int rc (sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL));
-    exit_on_error(rc, __LINE__, error_msg);
+    int seeding_max_seeding_distance (sqlite3_column_int(statement, c++));
+    int seeding_seed_count (sqlite3_column_int(statement, c++));
 
-    while(sqlite3_step(statement) == SQLITE_ROW)
-    {
-        int id;
-        int prime_start;
-        int prime_end;
-        int min;
-        int max;
+    int slope_start_of_decline (sqlite3_column_int(statement, c++));
+    int slope_max (sqlite3_column_int(statement, c++));
 
-        for(int c (0); c < sqlite3_column_count(statement); c++)
-        {
-            if(c == column_id.index)
-                id = sqlite3_column_int(statement,c);
-            else if(c == illumination_properties_table_column_prime_start.index)
-                prime_start = sqlite3_column_int(statement,c);
-            else if(c == illumination_properties_table_column_prime_end.index)
-                prime_end = sqlite3_column_int(statement,c);
-            else if(c == illumination_properties_table_column_min.index)
-                min = sqlite3_column_int(statement,c);
-            else if(c == illumination_properties_table_column_max.index)
-                max = sqlite3_column_int(statement,c);
-            else
-            {
-                std::cerr << "Unknown column: " << sqlite3_column_name(statement,c) <<
-                             " in file " << __FILE__ << " and line " << __LINE__ << std::endl;
-                exit(1);
-            }
-        }
-        ret.emplace(id, IlluminationProperties(Range(prime_start, prime_end), min, max));
-    }
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
-    return ret;
+    return SpecieProperties(name,
+                            id,
+                            AgeingProperties(ageing_start_of_decline, ageing_max_age),
+                            GrowthProperties(growth_max_height, growth_max_root_size, growth_max_canopy_width),
+                            IlluminationProperties(Range(illumination_prime_start, illumination_prime_end), illumination_min, illumination_max),
+                            SoilHumidityProperties(Range(soil_humidity_prime_start, soil_humidity_prime_end), soil_humidity_min, soil_humidity_max),
+                            TemperatureProperties(Range(temp_prime_start, temp_prime_end), temp_min, temp_max),
+                            SeedingProperties(seeding_max_seeding_distance, seeding_seed_count),
+                            SlopeProperties(slope_start_of_decline, slope_max));
 }
 
-std::map<int, SoilHumidityProperties> PlantDB::get_all_soil_humidity_properties()
+std::map<int,QString> PlantDB::get_all_species() const
 {
-    sqlite3 * db (open_db());
-    char * error_msg = 0;
-    sqlite3_stmt * statement;
-
-    static const std::string sql = "SELECT * FROM " + soil_humidity_properties_table_name + ";";
+    static const std::string sql = "SELECT * FROM " + specie_table_name + ";";
 
-    std::map<int,SoilHumidityProperties> ret;
+    std::map<int, QString> specie_id_to_name;
 
     // Prepare the statement
-    int rc (sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL));
-    exit_on_error(rc, __LINE__, error_msg);
+    sqlite3_stmt * statement (get_statement(sql, __func__));
 
-    while(sqlite3_step(statement) == SQLITE_ROW)
+    int rc;
+    while((rc = step_statement(statement)) == SQLITE_ROW)
     {
-        int id;
-        int prime_start;
-        int prime_end;
-        int min;
-        int max;
+        int id (0);
+        const char * plant_name ("");
 
         for(int c (0); c < sqlite3_column_count(statement); c++)
         {
             if(c == column_id.index)
                 id = sqlite3_column_int(statement,c);
-            else if(c == soil_humidity_properties_table_column_prime_start.index)
-                prime_start = sqlite3_column_int(statement,c);
-            else if(c == soil_humidity_properties_table_column_prime_end.index)
-                prime_end = sqlite3_column_int(statement,c);
-            else if(c == soil_humidity_properties_table_column_min.index)
-                min = sqlite3_column_int(statement,c);
-            else if(c == soil_humidity_properties_table_column_max.index)
-                max = sqlite3_column_int(statement,c);
+            else if(c == specie_table_column_specie_name.index)
+                plant_name = reinterpret_cast<const char*>(sqlite3_column_text(statement,c));
             else
-            {
-                std::cerr << "Unknown column: " << sqlite3_column_name(statement,c) <<
-                             " in file " << __FILE__ << " and line " << __LINE__ << std::endl;
-                exit(1);
-            }
+                exit_on_error(SQLITE_SCHEMA, __LINE__, sqlite3_mprintf("Unknown column: %s", sqlite3_column_name(statement,c)));
         }
-        ret.emplace(id, SoilHumidityProperties(Range(prime_start, prime_end), min, max));
+        specie_id_to_name.insert(std::pair<int,QString>(id, QString(plant_name)));
     }
+    exit_on_error(rc, __LINE__);
 
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
 
-    return ret;
+    return specie_id_to_name;
 }
 
-std::map<int, SeedingProperties> PlantDB::get_all_seeding_properties()
+/*
+ * The conditions are evaluated by SQLite so that only the species which tolerate them are decoded.
+ * A range is tolerated if it lies within [min, max] of the specie (within [0, max] for the slope).
+ */
+PlantDB::SpeciePropertiesHolder PlantDB::getPlantDataTolerating(const ToleranceQuery & query) const
 {
-    sqlite3 * db (open_db());
-    char * error_msg = 0;
-    sqlite3_stmt * statement;
-
-    static const std::string sql = "SELECT * FROM " + seeding_properties_table_name + ";";
-
-    std::map<int, SeedingProperties> ret;
-
-    // Prepare the statement
-    int rc (sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL));
-    exit_on_error(rc, __LINE__, error_msg);
-
-    while(sqlite3_step(statement) == SQLITE_ROW)
+    std::string sql (plant_data_select_code() + " WHERE 1");
+    if(query.has_illumination)
+        sql += " AND " + qualified_column_name(illumination_properties_table_name, illumination_properties_table_column_min) + " <= ?" +
+               " AND " + qualified_column_name(illumination_properties_table_name, illumination_properties_table_column_max) + " >= ?";
+    if(query.has_soil_humidity)
+        sql += " AND " + qualified_column_name(soil_humidity_properties_table_name, soil_humidity_properties_table_column_min) + " <= ?" +
+               " AND " + qualified_column_name(soil_humidity_properties_table_name, soil_humidity_properties_table_column_max) + " >= ?";
+    if(query.has_temperature)
+        sql += " AND " + qualified_column_name(temperature_properties_table_name, temperature_properties_table_column_min) + " <= ?" +
+               " AND " + qualified_column_name(temperature_properties_table_name, temperature_properties_table_column_max) + " >= ?";
+    if(query.has_slope)
+        sql += " AND " + qualified_column_name(slope_properties_table_name, slope_properties_table_column_max) + " >= ?";
+    sql += ";";
+
+    // One statement per combination of conditions, each of them is cached
+    sqlite3_stmt * statement (get_statement(sql, __func__));
+
+    int bind_index (1);
+    if(query.has_illumination)
     {
-        int id;
-        int max_seeding_distance;
-        int seed_count;
-
-        for(int c (0); c < sqlite3_column_count(statement); c++)
-        {
-            if(c == column_id.index)
-                id = sqlite3_column_int(statement,c);
-            else if(c == seeding_properties_table_column_max_seeding_distance.index)
-                max_seeding_distance = sqlite3_column_int(statement,c);
-            else if(c == seeding_properties_table_column_seed_count.index)
-                seed_count = sqlite3_column_int(statement,c);
-            else
-            {
-                std::cerr << "Unknown column: " << sqlite3_column_name(statement,c) <<
-                             " in file " << __FILE__ << " and line " << __LINE__ << std::endl;
-                exit(1);
-            }
-        }
-        ret.emplace(id, SeedingProperties(max_seeding_distance, seed_count));
+        exit_on_error(sqlite3_bind_int(statement, bind_index++, query.illumination_range.first), __LINE__);
+        exit_on_error(sqlite3_bind_int(statement, bind_index++, query.illumination_range.second), __LINE__);
     }
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
-
-    return ret;
-}
-
-std::map<int, TemperatureProperties> PlantDB::get_all_temp_properties()
-{
-    sqlite3 * db (open_db());
-    char * error_msg = 0;
-    sqlite3_stmt * statement;
-
-    static const std::string sql = "SELECT * FROM " + temperature_properties_table_name + ";";
-
-    std::map<int, TemperatureProperties> ret;
-
-    // Prepare the statement
-    int rc (sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL));
-    exit_on_error(rc, __LINE__, error_msg);
-
-    while(sqlite3_step(statement) == SQLITE_ROW)
+    if(query.has_soil_humidity)
     {
-        int id;
-        int prime_start;
-        int prime_end;
-        int min;
-        int max;
-
-        for(int c (0); c < sqlite3_column_count(statement); c++)
-        {
-            if(c == column_id.index)
-                id = sqlite3_column_int(statement,c);
-            else if(c == temperature_properties_table_column_prime_start.index)
-                prime_start = sqlite3_column_int(statement,c);
-            else if(c == temperature_properties_table_column_prime_end.index)
-                prime_end = sqlite3_column_int(statement,c);
-            else if(c == temperature_properties_table_column_min.index)
-                min = sqlite3_column_int(statement,c);
-            else if(c == temperature_properties_table_column_max.index)
-                max = sqlite3_column_int(statement,c);
-            else
-            {
-                std::cerr << "Unknown column: " << sqlite3_column_name(statement,c) <<
-                             " in file " << __FILE__ << " and line " << __LINE__ << std::endl;
-                exit(1);
-            }
-        }
-        ret.emplace(id, TemperatureProperties(Range(prime_start,prime_end), min, max));
+        exit_on_error(sqlite3_bind_int(statement, bind_index++, query.soil_humidity_range.first), __LINE__);
+        exit_on_error(sqlite3_bind_int(statement, bind_index++, query.soil_humidity_range.second), __LINE__);
     }
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
-
-    return ret;
-}
-
-std::map<int, SlopeProperties> PlantDB::get_all_slope_properties()
-{
-    sqlite3 * db (open_db());
-    char * error_msg = 0;
-    sqlite3_stmt * statement;
-
-    static const std::string sql = "SELECT * FROM " + slope_properties_table_name + ";";
-
-    std::map<int, SlopeProperties> ret;
-
-    // Prepare the statement
-    int rc (sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL));
-    exit_on_error(rc, __LINE__, error_msg);
-
-    while(sqlite3_step(statement) == SQLITE_ROW)
+    if(query.has_temperature)
     {
-        int id;
-        int start_of_decline;
-        int max;
-
-        for(int c (0); c < sqlite3_column_count(statement); c++)
-        {
-            if(c == column_id.index)
-                id = sqlite3_column_int(statement,c);
-            else if(c == slope_properties_table_column_start_of_decline.index)
-                start_of_decline = sqlite3_column_int(statement,c);
-            else if(c == slope_properties_table_column_max.index)
-                max = sqlite3_column_int(statement,c);
-            else
-            {
-                std::cerr << "Unknown column: " << sqlite3_column_name(statement,c) <<
-                             " in file " << __FILE__ << " and line " << __LINE__ << std::endl;
-                exit(1);
-            }
-        }
-        ret.emplace(id, SlopeProperties(start_of_decline, max));
+        exit_on_error(sqlite3_bind_int(statement, bind_index++, query.temperature_range.first), __LINE__);
+        exit_on_error(sqlite3_bind_int(statement, bind_index++, query.temperature_range.second), __LINE__);
     }
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+    if(query.has_slope)
+        exit_on_error(sqlite3_bind_int(statement, bind_index++, query.slope_range.second), __LINE__);
+
+    PlantDB::SpeciePropertiesHolder ret;
+    read_all_plant_data(statement, ret);
 
     return ret;
 }
@@ -509,11 +578,20 @@ std::map<int, SlopeProperties> PlantDB::get_all_slope_properties()
 /*********************
  * INSERT STATEMENTS *
  *********************/
+void PlantDB::insert_plant_data(SpecieProperties & data)
+{
+    data.specie_id = insert_plant(data.specie_name);
+    insert_ageing_properties(data.specie_id, data.ageing_properties);
+    insert_growth_properties(data.specie_id, data.growth_properties);
+    insert_illumination_properties(data.specie_id, data.illumination_properties);
+    insert_soil_humidity_properties(data.specie_id, data.soil_humidity_properties);
+    insert_seeding_properties(data.specie_id, data.seeding_properties);
+    insert_temp_properties(data.specie_id, data.temperature_properties);
+    insert_slope_properties(data.specie_id, data.slope_properties);
+}
+
 int PlantDB::insert_plant(QString name)
 {
-    sqlite3 * db (open_db());
-    char *error_msg = 0;
-    sqlite3_stmt * statement;
 
     static const std::string sql = "INSERT INTO " + specie_table_name + " ( " +
             specie_table_column_specie_name.name + " )" +
@@ -521,7 +599,7 @@ int PlantDB::insert_plant(QString name)
 
 
     // Prepare the statement
-    exit_on_error(sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL), __LINE__);
+    sqlite3_stmt * statement (get_statement(sql, __func__));
 
     // Perform binding
     QByteArray name_byte_array ( name.toUtf8());
@@ -529,22 +607,18 @@ int PlantDB::insert_plant(QString name)
     exit_on_error(sqlite3_bind_text(statement, specie_table_column_specie_name.index, name_c_string, -1/*null-terminated*/,NULL), __LINE__);
 
     // Commit
-    exit_on_error(sqlite3_step(statement), __LINE__);
+    exit_on_error(step_statement(statement), __LINE__);
 
-    int inserted_row_id(sqlite3_last_insert_rowid(db));
+    int inserted_row_id(sqlite3_last_insert_rowid(m_db));
 
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
 
     return inserted_row_id;
 }
 
 void PlantDB::insert_ageing_properties(int id, const AgeingProperties & ageing_properties)
 {
-    sqlite3 * db (open_db());
-    char *error_msg = 0;
-    sqlite3_stmt * statement;
 
     const static std::string sql = "INSERT INTO " + ageing_properties_table_name + " (" +
             column_id.name + "," +
@@ -554,7 +628,7 @@ void PlantDB::insert_ageing_properties(int id, const AgeingProperties & ageing_p
 
 
     // Prepare the statement
-    exit_on_error(sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL), __LINE__);
+    sqlite3_stmt * statement (get_statement(sql, __func__));
 
     // Perform binding
     exit_on_error(sqlite3_bind_int(statement, column_id.index+1, id), __LINE__);
@@ -562,18 +636,14 @@ void PlantDB::insert_ageing_properties(int id, const AgeingProperties & ageing_p
     exit_on_error(sqlite3_bind_int(statement, ageing_properties_table_column_max_age.index+1, ageing_properties.max_age), __LINE__);
 
     // Commit
-    exit_on_error(sqlite3_step(statement), __LINE__);
+    exit_on_error(step_statement(statement), __LINE__);
 
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
 }
 
 void PlantDB::insert_growth_properties(int id, const GrowthProperties & growth_properties)
 {
-    sqlite3 * db (open_db());
-    char *error_msg = 0;
-    sqlite3_stmt * statement;
 
     static const std::string sql = "INSERT INTO " + growth_properties_table_name + " (" +
             column_id.name + "," +
@@ -583,7 +653,7 @@ void PlantDB::insert_growth_properties(int id, const GrowthProperties & growth_p
             " VALUES ( ?, ?, ?, ?);";
 
     // Prepare the statement
-    exit_on_error(sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL), __LINE__);
+    sqlite3_stmt * statement (get_statement(sql, __func__));
 
     // Perform binding
     exit_on_error(sqlite3_bind_int(statement, column_id.index+1, id), __LINE__);
@@ -592,18 +662,14 @@ void PlantDB::insert_growth_properties(int id, const GrowthProperties & growth_p
     exit_on_error(sqlite3_bind_double(statement, growth_properties_table_column_max_root_size.index+1, growth_properties.max_root_size), __LINE__);
 
     // Commit
-    exit_on_error(sqlite3_step(statement), __LINE__);
+    exit_on_error(step_statement(statement), __LINE__);
 
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
 }
 
 void PlantDB::insert_illumination_properties(int id, const IlluminationProperties & illumination_properties)
 {
-    sqlite3 * db (open_db());
-    char *error_msg = 0;
-    sqlite3_stmt * statement;
 
     static const std::string sql = "INSERT INTO " + illumination_properties_table_name + " (" +
             column_id.name + "," +
@@ -614,7 +680,7 @@ void PlantDB::insert_illumination_properties(int id, const IlluminationPropertie
             " VALUES ( ?, ?, ?, ?, ?);";
 
     // Prepare the statement
-    exit_on_error(sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL), __LINE__);
+    sqlite3_stmt * statement (get_statement(sql, __func__));
 
     // Perform binding
     exit_on_error(sqlite3_bind_int(statement, column_id.index+1, id), __LINE__);
@@ -628,18 +694,14 @@ void PlantDB::insert_illumination_properties(int id, const IlluminationPropertie
                                    illumination_properties.max_illumination), __LINE__);
 
     // Commit
-    exit_on_error(sqlite3_step(statement), __LINE__);
+    exit_on_error(step_statement(statement), __LINE__);
 
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
 }
 
 void PlantDB::insert_soil_humidity_properties(int id, const SoilHumidityProperties & soil_humidity_properties)
 {
-    sqlite3 * db (open_db());
-    char *error_msg = 0;
-    sqlite3_stmt * statement;
 
     static const std::string sql = "INSERT INTO " + soil_humidity_properties_table_name + " (" +
             column_id.name + "," +
@@ -650,7 +712,7 @@ void PlantDB::insert_soil_humidity_properties(int id, const SoilHumidityProperti
             " VALUES ( ?, ?, ?, ?, ?);";
 
     // Prepare the statement
-    exit_on_error(sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL), __LINE__);
+    sqlite3_stmt * statement (get_statement(sql, __func__));
 
     // Perform binding
     exit_on_error(sqlite3_bind_int(statement, column_id.index+1, id), __LINE__);
@@ -660,18 +722,14 @@ void PlantDB::insert_soil_humidity_properties(int id, const SoilHumidityProperti
     exit_on_error(sqlite3_bind_int(statement, soil_humidity_properties_table_column_max.index+1, soil_humidity_properties.max_soil_humidity), __LINE__);
 
     // Commit
-    exit_on_error(sqlite3_step(statement), __LINE__);
+    exit_on_error(step_statement(statement), __LINE__);
 
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
 }
 
 void PlantDB::insert_seeding_properties(int id, const SeedingProperties & seeding_properties)
 {
-    sqlite3 * db (open_db());
-    char *error_msg = 0;
-    sqlite3_stmt * statement;
 
     static const std::string sql = "INSERT INTO " + seeding_properties_table_name + " (" +
             column_id.name + "," +
@@ -680,7 +738,7 @@ void PlantDB::insert_seeding_properties(int id, const SeedingProperties & seedin
             " VALUES ( ?, ?, ?);";
 
     // Prepare the statement
-    exit_on_error(sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL), __LINE__);
+    sqlite3_stmt * statement (get_statement(sql, __func__));
 
     // Perform binding
     exit_on_error(sqlite3_bind_int(statement, column_id.index+1, id), __LINE__);
@@ -688,18 +746,14 @@ void PlantDB::insert_seeding_properties(int id, const SeedingProperties & seedin
     exit_on_error(sqlite3_bind_int(statement, seeding_properties_table_column_seed_count.index+1, seeding_properties.seed_count), __LINE__);
 
     // Commit
-    exit_on_error(sqlite3_step(statement), __LINE__);
+    exit_on_error(step_statement(statement), __LINE__);
 
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
 }
 
 void PlantDB::insert_temp_properties(int id, const TemperatureProperties & temp_properties)
 {
-    sqlite3 * db (open_db());
-    char *error_msg = 0;
-    sqlite3_stmt * statement;
 
     static const std::string sql = "INSERT INTO " + temperature_properties_table_name + " (" +
             column_id.name + "," +
@@ -710,7 +764,7 @@ void PlantDB::insert_temp_properties(int id, const TemperatureProperties & temp_
             " VALUES ( ?, ?, ?, ?, ?);";
 
     // Prepare the statement
-    exit_on_error(sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL), __LINE__);
+    sqlite3_stmt * statement (get_statement(sql, __func__));
 
     // Perform binding
     exit_on_error(sqlite3_bind_int(statement, column_id.index+1, id), __LINE__);
@@ -720,18 +774,14 @@ void PlantDB::insert_temp_properties(int id, const TemperatureProperties & temp_
     exit_on_error(sqlite3_bind_int(statement, temperature_properties_table_column_max.index+1, temp_properties.max_temp), __LINE__);
 
     // Commit
-    exit_on_error(sqlite3_step(statement), __LINE__);
+    exit_on_error(step_statement(statement), __LINE__);
 
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
 }
 
 void PlantDB::insert_slope_properties(int id, const SlopeProperties & slope_properties)
 {
-    sqlite3 * db (open_db());
-    char *error_msg = 0;
-    sqlite3_stmt * statement;
 
     static const std::string sql = "INSERT INTO " + slope_properties_table_name + " (" +
             column_id.name + "," +
@@ -740,7 +790,7 @@ void PlantDB::insert_slope_properties(int id, const SlopeProperties & slope_prop
             " VALUES ( ?, ?, ?);";
 
     // Prepare the statement
-    exit_on_error(sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL), __LINE__);
+    sqlite3_stmt * statement (get_statement(sql, __func__));
 
     // Perform binding
     exit_on_error(sqlite3_bind_int(statement, column_id.index+1, id), __LINE__);
@@ -748,11 +798,10 @@ void PlantDB::insert_slope_properties(int id, const SlopeProperties & slope_prop
     exit_on_error(sqlite3_bind_int(statement, slope_properties_table_column_max.index+1, slope_properties.max), __LINE__);
 
     // Commit
-    exit_on_error(sqlite3_step(statement), __LINE__);
+    exit_on_error(step_statement(statement), __LINE__);
 
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
 }
 
 /*********************
@@ -760,16 +809,13 @@ void PlantDB::insert_slope_properties(int id, const SlopeProperties & slope_prop
  *********************/
 void PlantDB::update_specie_name(int id, QString name)
 {
-    sqlite3 * db (open_db());
-    char *error_msg = 0;
-    sqlite3_stmt * statement;
 
     const static  std::string sql = "UPDATE " + specie_table_name + " SET " +
                             specie_table_column_specie_name.name + " = ? " +
                       " WHERE " + column_id.name + " = ? ;";
 
     // Prepare the statement
-    exit_on_error(sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL), __LINE__);
+    sqlite3_stmt * statement (get_statement(sql, __func__));
 
     // Perform binding
     QByteArray name_byte_array ( name.toUtf8());
@@ -780,18 +826,14 @@ void PlantDB::update_specie_name(int id, QString name)
     exit_on_error(sqlite3_bind_int(statement, bind_index++, id), __LINE__);
 
     // Commit
-    exit_on_error(sqlite3_step(statement), __LINE__);
+    exit_on_error(step_statement(statement), __LINE__);
 
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
 }
 
 void PlantDB::update_ageing_properties(int id, const AgeingProperties & ageing_properties)
 {
-    sqlite3 * db (open_db());
-    char *error_msg = 0;
-    sqlite3_stmt * statement;
 
     const static std::string sql = "UPDATE " + ageing_properties_table_name + " SET " +
                 ageing_properties_table_column_start_of_decline.name + " = ?, " +
@@ -799,7 +841,7 @@ void PlantDB::update_ageing_properties(int id, const AgeingProperties & ageing_p
             " WHERE " + column_id.name + " = ? ;";
 
     // Prepare the statement
-    exit_on_error(sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL), __LINE__);
+    sqlite3_stmt * statement (get_statement(sql, __func__));
 
     // Perform binding
     int bind_index (ageing_properties_table_column_start_of_decline.index);
@@ -808,27 +850,23 @@ void PlantDB::update_ageing_properties(int id, const AgeingProperties & ageing_p
     exit_on_error(sqlite3_bind_int(statement, bind_index++, id), __LINE__);
 
     // Commit
-    exit_on_error(sqlite3_step(statement), __LINE__);
+    exit_on_error(step_statement(statement), __LINE__);
 
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
 }
 
 void PlantDB::update_growth_properties(int id, const GrowthProperties & growth_properties)
 {
-    sqlite3 * db (open_db());
-    char *error_msg = 0;
-    sqlite3_stmt * statement;
 
-    const std::string sql = "UPDATE " + growth_properties_table_name + " SET " +
+    static const std::string sql = "UPDATE " + growth_properties_table_name + " SET " +
                 growth_properties_table_column_max_height.name + " = ?," +
                 growth_properties_table_column_max_canopy_width.name + " = ?," +
                 growth_properties_table_column_max_root_size.name +  " = ?" +
             " WHERE " + column_id.name + " = ?;";
 
     // Prepare the statement
-    exit_on_error(sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL), __LINE__);
+    sqlite3_stmt * statement (get_statement(sql, __func__));
 
     // Perform binding
     int bind_index (growth_properties_table_column_max_height.index);
@@ -838,20 +876,16 @@ void PlantDB::update_growth_properties(int id, const GrowthProperties & growth_p
     exit_on_error(sqlite3_bind_int(statement, bind_index++, id), __LINE__);
 
     // Commit
-    exit_on_error(sqlite3_step(statement), __LINE__);
+    exit_on_error(step_statement(statement), __LINE__);
 
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
 }
 
 void PlantDB::update_illumination_properties(int id, const IlluminationProperties & illumination_properties)
 {
-    sqlite3 * db (open_db());
-    char *error_msg = 0;
-    sqlite3_stmt * statement;
 
-    const std::string sql = "UPDATE " + illumination_properties_table_name + " SET " +
+    static const std::string sql = "UPDATE " + illumination_properties_table_name + " SET " +
             illumination_properties_table_column_prime_start.name + " = ?,"+
             illumination_properties_table_column_prime_end.name + " = ?,"+
             illumination_properties_table_column_min.name + " = ?,"+
@@ -859,7 +893,7 @@ void PlantDB::update_illumination_properties(int id, const IlluminationPropertie
             " WHERE " + column_id.name + " = ?;";
 
     // Prepare the statement
-    exit_on_error(sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL), __LINE__);
+    sqlite3_stmt * statement (get_statement(sql, __func__));
 
     // Perform binding
     int bind_index (illumination_properties_table_column_prime_start.index);
@@ -870,18 +904,14 @@ void PlantDB::update_illumination_properties(int id, const IlluminationPropertie
     exit_on_error(sqlite3_bind_int(statement, bind_index++, id), __LINE__);
 
     // Commit
-    exit_on_error(sqlite3_step(statement), __LINE__);
+    exit_on_error(step_statement(statement), __LINE__);
 
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
 }
 
 void PlantDB::update_soil_humidity_properties(int id, const SoilHumidityProperties & soil_humidity_properties)
 {
-    sqlite3 * db (open_db());
-    char *error_msg = 0;
-    sqlite3_stmt * statement;
 
     static const std::string sql = "UPDATE " + soil_humidity_properties_table_name + " SET " +
             soil_humidity_properties_table_column_prime_start.name + " = ?," +
@@ -891,7 +921,7 @@ void PlantDB::update_soil_humidity_properties(int id, const SoilHumidityProperti
             " WHERE " + column_id.name + " = ?;";
 
     // Prepare the statement
-    exit_on_error(sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL), __LINE__);
+    sqlite3_stmt * statement (get_statement(sql, __func__));
 
     // Perform binding
     int bind_index (soil_humidity_properties_table_column_prime_start.index);
@@ -902,18 +932,14 @@ void PlantDB::update_soil_humidity_properties(int id, const SoilHumidityProperti
     exit_on_error(sqlite3_bind_int(statement, bind_index++, id), __LINE__);
 
     // Commit
-    exit_on_error(sqlite3_step(statement), __LINE__);
+    exit_on_error(step_statement(statement), __LINE__);
 
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
 }
 
 void PlantDB::update_seeding_properties(int id, const SeedingProperties & seeding_properties)
 {
-    sqlite3 * db (open_db());
-    char *error_msg = 0;
-    sqlite3_stmt * statement;
 
     static const std::string sql = "UPDATE " + seeding_properties_table_name + " SET " +
             seeding_properties_table_column_max_seeding_distance.name + " = ?," +
@@ -921,7 +947,7 @@ void PlantDB::update_seeding_properties(int id, const SeedingProperties & seedin
             " WHERE " + column_id.name + " = ?;";
 
     // Prepare the statement
-    exit_on_error(sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL), __LINE__);
+    sqlite3_stmt * statement (get_statement(sql, __func__));
 
     // Perform binding
     int bind_index (seeding_properties_table_column_max_seeding_distance.index);
@@ -930,18 +956,14 @@ void PlantDB::update_seeding_properties(int id, const SeedingProperties & seedin
     exit_on_error(sqlite3_bind_int(statement, bind_index++, id), __LINE__);
 
     // Commit
-    exit_on_error(sqlite3_step(statement), __LINE__);
+    exit_on_error(step_statement(statement), __LINE__);
 
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
 }
 
 void PlantDB::update_temp_properties(int id, const TemperatureProperties & temp_properties)
 {
-    sqlite3 * db (open_db());
-    char *error_msg = 0;
-    sqlite3_stmt * statement;
 
     static const std::string sql = "UPDATE " + temperature_properties_table_name + " SET " +
             temperature_properties_table_column_prime_start.name + " = ?," +
@@ -951,7 +973,7 @@ void PlantDB::update_temp_properties(int id, const TemperatureProperties & temp_
             " WHERE " + column_id.name + " = ?;";
 
     // Prepare the statement
-    exit_on_error(sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL), __LINE__);
+    sqlite3_stmt * statement (get_statement(sql, __func__));
 
     // Perform binding
     int bind_index (temperature_properties_table_column_prime_start.index);
@@ -962,18 +984,14 @@ void PlantDB::update_temp_properties(int id, const TemperatureProperties & temp_
     exit_on_error(sqlite3_bind_int(statement, bind_index++, id), __LINE__);
 
     // Commit
-    exit_on_error(sqlite3_step(statement), __LINE__);
+    exit_on_error(step_statement(statement), __LINE__);
 
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
 }
 
 void PlantDB::update_slope_properties(int id, const SlopeProperties & slope_properties)
 {
-    sqlite3 * db (open_db());
-    char *error_msg = 0;
-    sqlite3_stmt * statement;
 
     static const std::string sql = "UPDATE " + slope_properties_table_name + " SET " +
             slope_properties_table_column_start_of_decline.name + " = ?," +
@@ -981,7 +999,7 @@ void PlantDB::update_slope_properties(int id, const SlopeProperties & slope_prop
             " WHERE " + column_id.name + " = ?;";
 
     // Prepare the statement
-    exit_on_error(sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL), __LINE__);
+    sqlite3_stmt * statement (get_statement(sql, __func__));
 
     // Perform binding
     int bind_index (slope_properties_table_column_start_of_decline.index);
@@ -990,11 +1008,10 @@ void PlantDB::update_slope_properties(int id, const SlopeProperties & slope_prop
     exit_on_error(sqlite3_bind_int(statement, bind_index++, id), __LINE__);
 
     // Commit
-    exit_on_error(sqlite3_step(statement), __LINE__);
+    exit_on_error(step_statement(statement), __LINE__);
 
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
 }
 
 /*********************
@@ -1002,40 +1019,317 @@ void PlantDB::update_slope_properties(int id, const SlopeProperties & slope_prop
  *********************/
 void PlantDB::delete_plant(int id)
 {
-    sqlite3 * db (open_db());
-    char *error_msg = 0;
-    sqlite3_stmt * statement;
 
     static const std::string sql = "DELETE FROM " + specie_table_name + " WHERE " +
             column_id.name + " = ?;";
 
     // Prepare the statement
-    exit_on_error(sqlite3_prepare_v2(db, sql.c_str(),-1/*null-terminated*/,&statement,NULL), __LINE__);
+    sqlite3_stmt * statement (get_statement(sql, __func__));
 
     // Perform binding
     exit_on_error(sqlite3_bind_int(statement, 1, id), __LINE__);
 
     // Commit
-    exit_on_error(sqlite3_step(statement), __LINE__);
+    exit_on_error(step_statement(statement), __LINE__);
+
+    // reset the statement for later reuse
+    sqlite3_reset(statement);
+}
+
+/***********************
+ * TRANSACTION CONTROL *
+ ***********************/
+/*
+ * Each public mutation runs in a single transaction so that a specie is written with one journal
+ * sync and is never left half-written. The write lock is taken up front (IMMEDIATE) so that the
+ * transaction cannot fail later on when upgrading from a read lock.
+ */
+void PlantDB::begin_transaction()
+{
+    static const std::string sql = "BEGIN IMMEDIATE TRANSACTION;";
+
+    if(readOnly())
+        exit_on_error(SQLITE_READONLY, __LINE__, sqlite3_mprintf("Cannot modify %s: opened in read-only mode", m_db_file.c_str()));
+
+    sqlite3_stmt * statement (get_statement(sql, __func__));
+    exit_on_error(step_statement(statement), __LINE__);
+    sqlite3_reset(statement);
+}
 
-    // finalise the statement
-    sqlite3_finalize(statement);
-    sqlite3_close(db);
+void PlantDB::commit_transaction()
+{
+    static const std::string sql = "COMMIT TRANSACTION;";
+
+    sqlite3_stmt * statement (get_statement(sql, __func__));
+    exit_on_error(step_statement(statement, true/*a busy COMMIT leaves the transaction open*/), __LINE__);
+    sqlite3_reset(statement);
+
+    notify_listeners();
+}
+
+// Cannot fail: used to clean up after an error
+void PlantDB::rollback_transaction()
+{
+    if(!sqlite3_get_autocommit(m_db))
+        sqlite3_exec(m_db, "ROLLBACK TRANSACTION;", NULL, 0, NULL);
+}
+
+PlantDB::Transaction::Transaction(PlantDB & plant_db) :
+    m_plant_db(plant_db), m_committed(false)
+{
+    m_plant_db.begin_transaction();
+}
+
+PlantDB::Transaction::~Transaction()
+{
+    if(!m_committed)
+        m_plant_db.rollback_transaction();
+}
+
+void PlantDB::Transaction::commit()
+{
+    m_plant_db.commit_transaction();
+    m_committed = true;
+}
+
+/***************
+ * CHANGE FEED *
+ ***************/
+int PlantDB::subscribe(const ChangeListener & listener)
+{
+    int subscription_id (m_next_subscription_id++);
+    m_listeners.emplace(subscription_id, listener);
+    return subscription_id;
+}
+
+void PlantDB::unsubscribe(int subscription_id)
+{
+    m_listeners.erase(subscription_id);
+}
+
+/*
+ * Every insert, update and removal of a specie goes through a row of the species table (updatePlantData()
+ * always rewrites the name), so watching that table is enough. Property rows and cascading deletes are ignored.
+ */
+void PlantDB::update_hook(void * plant_db, int operation, const char * /*database_name*/, const char * table_name, sqlite3_int64 row_id)
+{
+    if(specie_table_name != table_name)
+        return;
+
+    ChangeType change (operation == SQLITE_INSERT ? SPECIE_INSERTED : (operation == SQLITE_DELETE ? SPECIE_REMOVED : SPECIE_UPDATED));
+    static_cast<PlantDB*>(plant_db)->m_pending_changes.push_back(std::pair<int, ChangeType>(row_id, change));
+}
+
+void PlantDB::rollback_hook(void * plant_db)
+{
+    static_cast<PlantDB*>(plant_db)->m_pending_changes.clear();
+}
+
+void PlantDB::notify_listeners()
+{
+    // Listeners may use the db again, so work on a copy of the changes
+    std::vector<std::pair<int, ChangeType> > changes;
+    changes.swap(m_pending_changes);
+
+    if(m_listeners.empty())
+        return;
+
+    for(auto change (changes.begin()); change != changes.end(); change++)
+        for(auto listener (m_listeners.begin()); listener != m_listeners.end(); listener++)
+            listener->second(change->first, change->second);
+}
+
+/*******************
+ * INSTRUMENTATION *
+ *******************/
+PlantDB::StatementStats::StatementStats() :
+    calls(0), rows(0), prepare_seconds(0), step_seconds(0), bytes_read(0)
+{
+
+}
+
+/*
+ * The trace callback is only registered while instrumentation is on, so that a disabled PlantDB
+ * pays nothing but a map insertion per prepared statement.
+ */
+void PlantDB::setInstrumentation(bool enabled)
+{
+    m_instrumented = enabled;
+    if(enabled)
+        exit_on_error( sqlite3_trace_v2(m_db, SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE | SQLITE_TRACE_ROW, &PlantDB::trace_callback, this), __LINE__);
+    else
+        exit_on_error( sqlite3_trace_v2(m_db, 0, NULL, NULL), __LINE__);
+}
+
+bool PlantDB::instrumentation() const
+{
+    return m_instrumented;
+}
+
+PlantDB::StatementStatsHolder PlantDB::statementStats() const
+{
+    return m_statement_stats;
+}
+
+void PlantDB::resetStatementStats()
+{
+    m_statement_stats.clear();
+}
+
+void PlantDB::writeStatementStats(std::ostream & out) const
+{
+    out << "{\n  \"statements\": [";
+    for(auto it (m_statement_stats.begin()); it != m_statement_stats.end(); it++)
+    {
+        out << (it == m_statement_stats.begin() ? "\n" : ",\n")
+            << "    {\"kind\": \"" << it->first << "\""
+            << ", \"calls\": " << it->second.calls
+            << ", \"rows\": " << it->second.rows
+            << ", \"prepare_us\": " << it->second.prepare_seconds * 1e6
+            << ", \"step_us\": " << it->second.step_seconds * 1e6
+            << ", \"bytes_read\": " << it->second.bytes_read << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+PlantDB::TracedStatement::TracedStatement(const char * p_kind) :
+    kind(p_kind), total_changes(0)
+{
+
+}
+
+/*
+ * SQLITE_TRACE_STMT fires when a statement starts running, SQLITE_TRACE_ROW for every row it returns and
+ * SQLITE_TRACE_PROFILE once it is done or reset. The profile time of sqlite only has a millisecond resolution
+ * on some platforms, so statements are timed with a steady clock instead. Rows changed are taken from the
+ * total change count of the connection, which only moves for inserts, updates and deletes.
+ * Statements run through sqlite3_exec() have no kind: they are recorded as "other", with the sqlite timing.
+ */
+int PlantDB::trace_callback(unsigned event, void * plant_db, void * p, void * x)
+{
+    PlantDB * db (static_cast<PlantDB*>(plant_db));
+    sqlite3_stmt * statement (static_cast<sqlite3_stmt*>(p));
+
+    auto traced (db->m_traced_statements.find(statement));
+    bool known (traced != db->m_traced_statements.end());
+
+    if(event == SQLITE_TRACE_STMT)
+    {
+        // Also fired for each trigger, with a comment as SQL
+        if(known && std::string(static_cast<const char*>(x)).compare(0, 2, "--") != 0)
+        {
+            traced->second.start = std::chrono::steady_clock::now();
+            traced->second.total_changes = sqlite3_total_changes(db->m_db);
+        }
+        return 0;
+    }
+
+    StatementStats & stats (db->m_statement_stats[known ? traced->second.kind : "other"]);
+
+    if(event == SQLITE_TRACE_ROW)
+    {
+        stats.rows++;
+        for(int column (0); column < sqlite3_column_count(statement); column++)
+        {
+            switch(sqlite3_column_type(statement, column))
+            {
+            case SQLITE_INTEGER:
+            case SQLITE_FLOAT:
+                stats.bytes_read += 8;
+                break;
+            case SQLITE_TEXT:
+            case SQLITE_BLOB:
+                stats.bytes_read += sqlite3_column_bytes(statement, column);
+                break;
+            }
+        }
+    }
+    else if(event == SQLITE_TRACE_PROFILE)
+    {
+        stats.calls++;
+        if(known)
+        {
+            stats.step_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - traced->second.start).count();
+            stats.rows += sqlite3_total_changes(db->m_db) - traced->second.total_changes;
+        }
+        else
+        {
+            stats.step_seconds += *static_cast<sqlite3_int64*>(x) * 1e-9;
+        }
+    }
+
+    return 0;
 }
 
 /******************
  * HELPER METHODS *
  ******************/
-void PlantDB::exit_on_error(int p_code, int p_line,  char * p_error_msg)
+sqlite3_stmt * PlantDB::get_statement(const std::string & sql, const char * kind) const
+{
+    auto it (m_statements.find(sql));
+    if(it != m_statements.end())
+    {
+        // Already prepared: reset it, in case an error interrupted its last use, and clear any previous bindings
+        sqlite3_reset(it->second);
+        sqlite3_clear_bindings(it->second);
+        return it->second;
+    }
+
+    std::chrono::steady_clock::time_point start (std::chrono::steady_clock::now());
+    sqlite3_stmt * statement;
+    exit_on_error(sqlite3_prepare_v2(m_db, sql.c_str(),-1/*null-terminated*/,&statement,NULL), __LINE__);
+    m_statements.emplace(sql, statement);
+    m_traced_statements.emplace(statement, TracedStatement(kind));
+
+    if(m_instrumented)
+        m_statement_stats[kind].prepare_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return statement;
+}
+
+void PlantDB::finalize_statements()
+{
+    for(auto it (m_statements.begin()); it != m_statements.end(); it++)
+        sqlite3_finalize(it->second);
+    m_statements.clear();
+    m_traced_statements.clear();
+}
+
+/*
+ * The busy timeout covers most lock contention, but sqlite gives up straight away in some cases (SQLITE_LOCKED,
+ * a stale WAL snapshot, a potential deadlock...). Such statements are reset and run again with an exponential backoff.
+ * Inside an explicit transaction a statement can only be run again if restartable (COMMIT): otherwise the error is
+ * reported and the transaction rolled back. A read restarted after returning rows returns them again, which the
+ * callers absorb as they key the results by id.
+ */
+int PlantDB::step_statement(sqlite3_stmt * statement, bool restartable) const
+{
+    int rc (sqlite3_step(statement));
+    for(int retry (0), backoff (BUSY_RETRY_BACKOFF); retry < BUSY_RETRIES && ((rc & 0xff) == SQLITE_BUSY || (rc & 0xff) == SQLITE_LOCKED) &&
+                                                      (restartable || sqlite3_get_autocommit(m_db)); retry++, backoff *= 2)
+    {
+        sqlite3_reset(statement);
+        std::this_thread::sleep_for(std::chrono::milliseconds(backoff));
+        rc = sqlite3_step(statement);
+    }
+    return rc;
+}
+
+void PlantDB::exit_on_error(int p_code, int p_line,  char * p_error_msg) const
 {
     if(p_code != SQLITE_OK && p_code != SQLITE_DONE)
-    {        
+    {
+        std::string message (p_error_msg ? p_error_msg : sqlite3_errstr(p_code));
+        sqlite3_free(p_error_msg);
+
+        if(m_open_flags & EXCEPTION_MODE)
+            throw PlantDBException(p_code, p_line, message);
+
         std::cerr << "Database failure!" << std::endl;
         std::cerr << "Error code: " << p_code << std::endl;
         std::cerr << "File: " << __FILE__ << std::endl;
         std::cerr << "Line: " << p_line << std::endl;
-        std::cerr << "Error message:" << p_error_msg << std::endl;
-        sqlite3_free(p_error_msg);
+        std::cerr << "Error message:" << message << std::endl;
         exit(1);
     }
 }
@@ -5,7 +5,14 @@
 
 #include <sqlite3.h>
 #include <string>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iosfwd>
 #include <map>
+#include <memory>
+#include <stdexcept>
+#include <vector>
 #include <QString>
 
 struct Column{
@@ -29,6 +36,9 @@ static const std::string specie_table_creation_code =
                 "CREATE TABLE IF NOT EXISTS " + specie_table_name + "( " +
                                                        column_id.name + " INTEGER PRIMARY KEY," +
                                                        specie_table_column_specie_name.name + " TEXT NOT NULL);";
+static const std::string specie_table_name_index_creation_code =
+                "CREATE INDEX IF NOT EXISTS " + specie_table_name + "_" + specie_table_column_specie_name.name + "_index ON " +
+                                                       specie_table_name + "(" + specie_table_column_specie_name.name + ");";
 
 /***************************
  * GROWTH PROPERTIES TABLE *
@@ -43,6 +53,9 @@ static const std::string growth_properties_table_creation_code =
                                                        growth_properties_table_column_max_height.name + " REAL NOT NULL," +
                                                        growth_properties_table_column_max_canopy_width.name + " REAL NOT NULL," +
                                                        growth_properties_table_column_max_root_size.name + " REAL NOT NULL);";
+static const std::string growth_properties_table_id_index_creation_code =
+                "CREATE INDEX IF NOT EXISTS " + growth_properties_table_name + "_" + column_id.name + "_index ON " +
+                                                       growth_properties_table_name + "(" + column_id.name + ");";
 
 /*********************************
  * ILLUMINATION PROPERTIES TABLE *
@@ -59,6 +72,13 @@ static const std::string illumination_properties_table_creation_code =
                                                        illumination_properties_table_column_prime_end.name + " INT NOT NULL, " +
                                                        illumination_properties_table_column_min.name + " INT NOT NULL, " +
                                                        illumination_properties_table_column_max.name + " INT NOT NULL);";
+static const std::string illumination_properties_table_id_index_creation_code =
+                "CREATE INDEX IF NOT EXISTS " + illumination_properties_table_name + "_" + column_id.name + "_index ON " +
+                                                       illumination_properties_table_name + "(" + column_id.name + ");";
+static const std::string illumination_properties_table_envelope_index_creation_code =
+                "CREATE INDEX IF NOT EXISTS " + illumination_properties_table_name + "_envelope_index ON " +
+                                                       illumination_properties_table_name + "(" + illumination_properties_table_column_min.name + "," +
+                                                       illumination_properties_table_column_max.name + ");";
 
 /**********************************
  * SOIL HUMIDITY PROPERTIES TABLE *
@@ -75,6 +95,13 @@ static const std::string soil_humidity_properties_table_creation_code =
                                                        soil_humidity_properties_table_column_prime_end.name + " INT NOT NULL, " +
                                                        soil_humidity_properties_table_column_min.name + " INT NOT NULL, " +
                                                        soil_humidity_properties_table_column_max.name + " INT NOT NULL);";
+static const std::string soil_humidity_properties_table_id_index_creation_code =
+                "CREATE INDEX IF NOT EXISTS " + soil_humidity_properties_table_name + "_" + column_id.name + "_index ON " +
+                                                       soil_humidity_properties_table_name + "(" + column_id.name + ");";
+static const std::string soil_humidity_properties_table_envelope_index_creation_code =
+                "CREATE INDEX IF NOT EXISTS " + soil_humidity_properties_table_name + "_envelope_index ON " +
+                                                       soil_humidity_properties_table_name + "(" + soil_humidity_properties_table_column_min.name + "," +
+                                                       soil_humidity_properties_table_column_max.name + ");";
 
 /**********************************
  * SEEDING PROPERTIES TABLE *
@@ -87,6 +114,9 @@ static const std::string seeding_properties_table_creation_code =
                                                        column_id.name + " INTEGER REFERENCES " + specie_table_name + "(" + column_id.name + ") ON DELETE CASCADE," +
                                                        seeding_properties_table_column_max_seeding_distance.name + " INT NOT NULL," +
                                                        seeding_properties_table_column_seed_count.name + " INT NOT NULL);";
+static const std::string seeding_properties_table_id_index_creation_code =
+                "CREATE INDEX IF NOT EXISTS " + seeding_properties_table_name + "_" + column_id.name + "_index ON " +
+                                                       seeding_properties_table_name + "(" + column_id.name + ");";
 
 /***************************
  * AGEING PROPERTIES TABLE *
@@ -99,6 +129,9 @@ static const std::string ageing_properties_table_creation_code =
                                                        column_id.name + " INTEGER REFERENCES " + specie_table_name + "(" + column_id.name + ") ON DELETE CASCADE," +
                                                        ageing_properties_table_column_start_of_decline.name + " INT NOT NULL," +
                                                        ageing_properties_table_column_max_age.name + " INT NOT NULL);";
+static const std::string ageing_properties_table_id_index_creation_code =
+                "CREATE INDEX IF NOT EXISTS " + ageing_properties_table_name + "_" + column_id.name + "_index ON " +
+                                                       ageing_properties_table_name + "(" + column_id.name + ");";
 
 /********************************
  * TEMPERATURE PROPERTIES TABLE *
@@ -115,6 +148,13 @@ static const std::string temperature_properties_table_creation_code =
                                                        temperature_properties_table_column_prime_end.name + " INT NOT NULL," +
                                                        temperature_properties_table_column_min.name + " INT NOT NULL," +
                                                        temperature_properties_table_column_max.name + ");";
+static const std::string temperature_properties_table_id_index_creation_code =
+                "CREATE INDEX IF NOT EXISTS " + temperature_properties_table_name + "_" + column_id.name + "_index ON " +
+                                                       temperature_properties_table_name + "(" + column_id.name + ");";
+static const std::string temperature_properties_table_envelope_index_creation_code =
+                "CREATE INDEX IF NOT EXISTS " + temperature_properties_table_name + "_envelope_index ON " +
+                                                       temperature_properties_table_name + "(" + temperature_properties_table_column_min.name + "," +
+                                                       temperature_properties_table_column_max.name + ");";
 
 /********************************
  * SLOPE PROPERTIES TABLE *
@@ -127,38 +167,135 @@ static const std::string slope_properties_table_creation_code =
                                                        column_id.name + " INTEGER REFERENCES " + specie_table_name + "(" + column_id.name + ") ON DELETE CASCADE," +
                                                        slope_properties_table_column_start_of_decline.name + " INT NOT NULL," +
                                                        slope_properties_table_column_max.name + ");";
+static const std::string slope_properties_table_id_index_creation_code =
+                "CREATE INDEX IF NOT EXISTS " + slope_properties_table_name + "_" + column_id.name + "_index ON " +
+                                                       slope_properties_table_name + "(" + column_id.name + ");";
+static const std::string slope_properties_table_max_index_creation_code =
+                "CREATE INDEX IF NOT EXISTS " + slope_properties_table_name + "_" + slope_properties_table_column_max.name + "_index ON " +
+                                                       slope_properties_table_name + "(" + slope_properties_table_column_max.name + ");";
+
+/*
+ * Environmental conditions which a specie must tolerate. Every condition is optional. A range
+ * [min, max] requires the whole range to be tolerated, a single value is a range of one. Ranges
+ * given with min > max are swapped.
+ */
+class ToleranceQuery {
+public:
+    ToleranceQuery() : has_illumination(false), has_soil_humidity(false), has_temperature(false), has_slope(false) {}
+
+    ToleranceQuery & illumination(int min, int max) { has_illumination = true; illumination_range = Range(std::min(min, max), std::max(min, max)); return *this; }
+    ToleranceQuery & illumination(int value) { return illumination(value, value); }
+    ToleranceQuery & soilHumidity(int min, int max) { has_soil_humidity = true; soil_humidity_range = Range(std::min(min, max), std::max(min, max)); return *this; }
+    ToleranceQuery & soilHumidity(int value) { return soilHumidity(value, value); }
+    ToleranceQuery & temperature(int min, int max) { has_temperature = true; temperature_range = Range(std::min(min, max), std::max(min, max)); return *this; }
+    ToleranceQuery & temperature(int value) { return temperature(value, value); }
+    ToleranceQuery & slope(int min, int max) { has_slope = true; slope_range = Range(std::min(min, max), std::max(min, max)); return *this; }
+    ToleranceQuery & slope(int value) { return slope(value, value); }
+
+    bool has_illumination;
+    Range illumination_range;
+    bool has_soil_humidity;
+    Range soil_humidity_range;
+    bool has_temperature;
+    Range temperature_range;
+    bool has_slope;
+    Range slope_range;
+};
+
+// Thrown instead of exiting when a PlantDB is opened in EXCEPTION_MODE
+class PlantDBException : public std::runtime_error {
+public:
+    PlantDBException(int code, int line, const std::string & message);
+    int code() const; // sqlite result code
+    int line() const; // In plant_db.cpp
+    bool busy() const; // The db was still locked after retrying: the operation can be tried again later
+
+private:
+    int m_code;
+    int m_line;
+};
 
 class PlantDB {
 public:
     typedef std::map<int, SpecieProperties> SpeciePropertiesHolder;
 
-    PlantDB();
-    SpeciePropertiesHolder getAllPlantData();
-    std::map<int,QString> get_all_species();
+    enum OpenFlags{
+        DEFAULT_MODE = 0,
+        WAL_MODE = 1 << 0, // Write-ahead logging: readers run concurrently with a writer
+        BULK_LOAD_MODE = 1 << 1, // No journal, sync or foreign key checks. Only to populate a new db: a crash corrupts it. Not with EXCEPTION_MODE
+        EXCEPTION_MODE = 1 << 2, // Errors throw a PlantDBException, after rolling back the ongoing mutation, instead of exiting
+        READ_ONLY_MODE = 1 << 3, // Inserts, updates and removals fail with SQLITE_READONLY. The db must exist
+        IMMUTABLE_MODE = 1 << 4 // Read only, and no locking: nothing may write to the db file while it is open
+    };
+
+    enum ChangeType{
+        SPECIE_INSERTED,
+        SPECIE_UPDATED,
+        SPECIE_REMOVED
+    };
+
+    // Called once per changed specie, after the transaction changing it has been committed
+    typedef std::function<void(int specie_id, ChangeType change)> ChangeListener;
+
+    struct StatementStats{
+        long calls; // Executions
+        long rows; // Returned by a select, changed by an insert, update or delete
+        double prepare_seconds;
+        double step_seconds;
+        long bytes_read; // Size of the returned columns
+
+        StatementStats();
+    };
+    typedef std::map<std::string, StatementStats> StatementStatsHolder; // Keyed by the method running the statement
+
+    PlantDB(int open_flags = DEFAULT_MODE); // Opens Settings::db_file()
+    PlantDB(const std::string & db_file, int open_flags = DEFAULT_MODE); // Created if it does not exist
+    ~PlantDB();
+    SpeciePropertiesHolder getAllPlantData() const;
+    std::unique_ptr<SpecieProperties> getPlantData(int id) const; // NULL if there is no such specie
+    SpeciePropertiesHolder getPlantData(const std::vector<int> & ids) const; // Unknown ids are skipped
+    SpeciePropertiesHolder getPlantDataByName(const QString & name) const; // Names are not unique
+    SpeciePropertiesHolder getPlantDataTolerating(const ToleranceQuery & query) const;
+    std::map<int,QString> get_all_species() const;
     void insertNewPlantData(SpecieProperties & data);
+    void insertNewPlantData(std::vector<SpecieProperties> & data); // All species in a single transaction
     void updatePlantData(const SpecieProperties & data);
     void removePlant(int p_id);
 
+    bool readOnly() const; // Opened in READ_ONLY_MODE or IMMUTABLE_MODE
+    int dataVersion() const; // Changes whenever another connection (or process) commits to the db
+
+    int subscribe(const ChangeListener & listener); // Returns an id to unsubscribe with
+    void unsubscribe(int subscription_id);
+
+    void setInstrumentation(bool enabled); // Records per statement stats. Off by default
+    bool instrumentation() const;
+    StatementStatsHolder statementStats() const;
+    void resetStatementStats();
+    void writeStatementStats(std::ostream & out) const; // As JSON
+
     static bool load_full_db_location(std::string & db_location);
     static bool file_exists(const std::string & path);
 
 private:
+    // A PlantDB owns its connection and prepared statements
+    PlantDB(const PlantDB & other);
+    PlantDB & operator=(const PlantDB & other);
+
     void init();
+    int schema_version();
 
     /*********************
      * SELECT STATEMENTS *
      *********************/
-    std::map<int, AgeingProperties> get_all_ageing_properties();
-    std::map<int, GrowthProperties> get_all_growth_properties();
-    std::map<int, IlluminationProperties> get_all_illumination_properties();
-    std::map<int, SoilHumidityProperties> get_all_soil_humidity_properties();
-    std::map<int, SeedingProperties> get_all_seeding_properties();
-    std::map<int, TemperatureProperties> get_all_temp_properties();
-    std::map<int, SlopeProperties> get_all_slope_properties();
+    static const std::string & plant_data_select_code();
+    SpecieProperties read_plant_data(sqlite3_stmt * statement) const;
+    void read_all_plant_data(sqlite3_stmt * statement, SpeciePropertiesHolder & out) const;
 
     /*********************
      * INSERT STATEMENTS *
      *********************/
+    void insert_plant_data(SpecieProperties & data);
     int insert_plant(QString name);
     void insert_ageing_properties(int id, const AgeingProperties & ageing_properties);
     void insert_growth_properties(int id, const GrowthProperties & growth_properties);
@@ -185,8 +322,64 @@ private:
      *********************/
     void delete_plant(int id);
 
+    /***********************
+     * TRANSACTION CONTROL *
+     ***********************/
+    // Rolls the transaction back unless it was committed, e.g. when an error is thrown
+    class Transaction {
+    public:
+        Transaction(PlantDB & plant_db);
+        ~Transaction();
+        void commit();
+
+    private:
+        PlantDB & m_plant_db;
+        bool m_committed;
+    };
+
+    void begin_transaction();
+    void commit_transaction();
+    void rollback_transaction();
+
+    /***************
+     * CHANGE FEED *
+     ***************/
+    static void update_hook(void * plant_db, int operation, const char * database_name, const char * table_name, sqlite3_int64 row_id);
+    static void rollback_hook(void * plant_db);
+    void notify_listeners();
+
+    /*******************
+     * INSTRUMENTATION *
+     *******************/
+    struct TracedStatement{
+        const char * kind;
+        std::chrono::steady_clock::time_point start; // Of the ongoing execution
+        int total_changes; // Of the connection when the ongoing execution started
+
+        TracedStatement(const char * p_kind);
+    };
+
+    static int trace_callback(unsigned event, void * plant_db, void * p, void * x);
+
     sqlite3* open_db();
-    void exit_on_error(int p_code, int p_line, char * p_error_msg = NULL);
+    sqlite3_stmt * get_statement(const std::string & sql, const char * kind) const; // kind: name of the calling method, followed by its parameters if overloaded
+    void finalize_statements();
+    int step_statement(sqlite3_stmt * statement, bool restartable = false) const; // Retries busy and locked statements
+    void exit_on_error(int p_code, int p_line, char * p_error_msg = NULL) const;
+
+    std::string m_db_file;
+    int m_open_flags;
+    sqlite3 * m_db;
+    // Reads are const: the statement cache and the stats are not part of the state of the db
+    mutable std::map<std::string, sqlite3_stmt*> m_statements; // Prepared statements, keyed by their SQL
+    mutable std::map<sqlite3_stmt*, TracedStatement> m_traced_statements;
+
+    bool m_instrumented;
+    mutable StatementStatsHolder m_statement_stats;
+
+    std::map<int, ChangeListener> m_listeners;
+    int m_next_subscription_id;
+    std::vector<std::pair<int, ChangeType> > m_pending_changes; // Changes of the ongoing transaction
 };
 
 #endif // PLANT_DB_H
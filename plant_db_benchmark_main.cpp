@@ -0,0 +1,268 @@
+#include "plant_db.h"
+#include "plant_db_generator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define DEFAULT_SIZES "1000,10000,100000,1000000"
+#define DEFAULT_OUTPUT "plantdb_benchmark.json"
+#define DEFAULT_DIRECTORY "/tmp"
+#define DEFAULT_SEED 42
+#define POPULATE_BATCH_SIZE 10000
+
+/*
+ * Times the public PlantDB API on synthetic databases of increasing sizes. Every size gets a fresh
+ * database populated from the same seed, so that runs on the same machine are comparable.
+ */
+
+struct Measurement {
+    std::size_t species; // In the db
+    std::string operation;
+    std::size_t items_per_call; // Species read or written by each call
+    std::vector<double> latencies; // s
+    long peak_rss_kb; // High-water mark of the resident set size during the calls. -1 if unavailable
+};
+
+/*
+ * The high-water mark of the resident set size (VmHWM) is reset before each operation, so that it reports the
+ * peak of that operation, transient allocations included, rather than the peak of the whole process.
+ */
+static bool reset_peak_rss()
+{
+    std::ofstream clear_refs ("/proc/self/clear_refs");
+    clear_refs << "5";
+    clear_refs.close();
+    return !clear_refs.fail();
+}
+
+static long peak_rss_kb()
+{
+    std::ifstream status ("/proc/self/status");
+    for(std::string line; std::getline(status, line);)
+    {
+        if(line.compare(0, 6, "VmHWM:") == 0)
+            return std::atol(line.c_str() + 6);
+    }
+    return -1;
+}
+
+static double percentile(std::vector<double> values, double p)
+{
+    if(values.empty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<std::size_t>(p * values.size()))];
+}
+
+/*
+ * Times op(i) for each call i. setup(i), which prepares the input of the call (e.g. generates the species to
+ * insert), runs before and is not timed.
+ */
+template <typename Setup, typename Operation> static Measurement measure(std::size_t species, const std::string & operation,
+                                                                        std::size_t calls, std::size_t items_per_call,
+                                                                        Setup setup, Operation op)
+{
+    Measurement measurement;
+    measurement.species = species;
+    measurement.operation = operation;
+    measurement.items_per_call = items_per_call;
+
+    bool peak_reset (reset_peak_rss());
+    for(std::size_t i (0); i < calls; i++)
+    {
+        setup(i);
+        std::chrono::steady_clock::time_point start (std::chrono::steady_clock::now());
+        op(i);
+        measurement.latencies.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    measurement.peak_rss_kb = peak_reset ? peak_rss_kb() : -1;
+
+    std::cerr << "  " << operation << ": " << calls << " calls, p50 " << percentile(measurement.latencies, .5) * 1e6 << " us" << std::endl;
+
+    return measurement;
+}
+
+template <typename Operation> static Measurement measure(std::size_t species, const std::string & operation,
+                                                        std::size_t calls, std::size_t items_per_call, Operation op)
+{
+    return measure(species, operation, calls, items_per_call, [](std::size_t) {}, op);
+}
+
+static void benchmark(std::size_t size, const std::string & db_file, unsigned seed, std::vector<Measurement> & results)
+{
+    std::cerr << size << " species" << std::endl;
+
+    std::remove(db_file.c_str());
+    std::mt19937 rng (seed);
+    PlantDBGenerator generator (seed);
+    std::vector<int> ids;
+
+    {
+        PlantDB plant_db (db_file);
+
+        // Populate
+        std::size_t batches ((size + POPULATE_BATCH_SIZE - 1) / POPULATE_BATCH_SIZE);
+        std::vector<SpecieProperties> species;
+        results.push_back(measure(size, "insertNewPlantData(batch)", batches, std::min<std::size_t>(size, POPULATE_BATCH_SIZE), [&](std::size_t batch) {
+            species = generator.generate(std::min(size, (batch + 1) * POPULATE_BATCH_SIZE) - batch * POPULATE_BATCH_SIZE);
+        }, [&](std::size_t) {
+            plant_db.insertNewPlantData(species);
+            for(auto it (species.begin()); it != species.end(); it++)
+                ids.push_back(it->specie_id);
+        }));
+
+        auto random_id ([&]() { return ids[std::uniform_int_distribution<std::size_t>(0, ids.size() - 1)(rng)]; });
+
+        // Reads
+        std::size_t full_reads (std::max<std::size_t>(3, std::min<std::size_t>(20, 1000000 / size)));
+        results.push_back(measure(size, "getAllPlantData", full_reads, size, [&](std::size_t) {
+            plant_db.getAllPlantData();
+        }));
+
+        int id (0);
+        results.push_back(measure(size, "getPlantData(id)", 1000, 1, [&](std::size_t) {
+            id = random_id();
+        }, [&](std::size_t) {
+            plant_db.getPlantData(id);
+        }));
+
+        std::vector<int> lookup;
+        results.push_back(measure(size, "getPlantData(ids)", 20, std::min<std::size_t>(size, 1000), [&](std::size_t) {
+            lookup.clear();
+            for(std::size_t i (0); i < std::min<std::size_t>(size, 1000); i++)
+                lookup.push_back(random_id());
+        }, [&](std::size_t) {
+            plant_db.getPlantData(lookup);
+        }));
+
+        QString name;
+        results.push_back(measure(size, "getPlantDataByName", 1000, 1, [&](std::size_t) {
+            name = QString("Specie %1").arg(std::uniform_int_distribution<std::size_t>(0, size - 1)(rng));
+        }, [&](std::size_t) {
+            plant_db.getPlantDataByName(name);
+        }));
+
+        ToleranceQuery query;
+        results.push_back(measure(size, "getPlantDataTolerating", 20, 1, [&](std::size_t) {
+            query = ToleranceQuery().temperature(std::uniform_int_distribution<int>(-50, 50)(rng)).illumination(12);
+        }, [&](std::size_t) {
+            plant_db.getPlantDataTolerating(query);
+        }));
+
+        // Writes
+        std::unique_ptr<SpecieProperties> specie;
+        results.push_back(measure(size, "insertNewPlantData", 200, 1, [&](std::size_t) {
+            specie.reset(new SpecieProperties(generator.generate()));
+        }, [&](std::size_t) {
+            plant_db.insertNewPlantData(*specie);
+            ids.push_back(specie->specie_id);
+        }));
+
+        results.push_back(measure(size, "updatePlantData", 200, 1, [&](std::size_t) {
+            specie.reset(new SpecieProperties(generator.generate()));
+            specie->specie_id = random_id();
+        }, [&](std::size_t) {
+            plant_db.updatePlantData(*specie);
+        }));
+
+        std::shuffle(ids.begin(), ids.end(), rng);
+        results.push_back(measure(size, "removePlant", 200, 1, [&](std::size_t) {
+            plant_db.removePlant(ids.back());
+            ids.pop_back();
+        }));
+    }
+
+    std::remove(db_file.c_str());
+}
+
+static void write_json(std::ostream & out, const std::vector<Measurement> & results, unsigned seed)
+{
+    out << "{\n"
+        << "  \"benchmark\": \"PlantDB\",\n"
+        << "  \"sqlite_version\": \"" << sqlite3_libversion() << "\",\n"
+        << "  \"seed\": " << seed << ",\n"
+        << "  \"results\": [";
+
+    for(std::size_t i (0); i < results.size(); i++)
+    {
+        const Measurement & m (results[i]);
+        double total (0);
+        for(auto it (m.latencies.begin()); it != m.latencies.end(); it++)
+            total += *it;
+
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\"species\": " << m.species
+            << ", \"operation\": \"" << m.operation << "\""
+            << ", \"calls\": " << m.latencies.size()
+            << ", \"items_per_call\": " << m.items_per_call
+            << ", \"ops_per_sec\": " << (total > 0 ? m.latencies.size() / total : 0)
+            << ", \"items_per_sec\": " << (total > 0 ? m.latencies.size() * m.items_per_call / total : 0)
+            << ", \"p50_us\": " << percentile(m.latencies, .5) * 1e6
+            << ", \"p99_us\": " << percentile(m.latencies, .99) * 1e6
+            << ", \"peak_rss_kb\": " << m.peak_rss_kb << "}";
+    }
+
+    out << "\n  ]\n}\n";
+}
+
+int main(int argc, char *argv[])
+{
+    std::string sizes_argument (DEFAULT_SIZES), output (DEFAULT_OUTPUT), directory (DEFAULT_DIRECTORY);
+    unsigned seed (DEFAULT_SEED);
+
+    for(int i (1); i < argc; i++)
+    {
+        std::string argument (argv[i]);
+        if(i + 1 < argc && argument == "--sizes")
+            sizes_argument = argv[++i];
+        else if(i + 1 < argc && argument == "--output")
+            output = argv[++i];
+        else if(i + 1 < argc && argument == "--dir")
+            directory = argv[++i];
+        else if(i + 1 < argc && argument == "--seed")
+            seed = std::strtoul(argv[++i], NULL, 10);
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--sizes " << DEFAULT_SIZES << "] [--output " << DEFAULT_OUTPUT << "]"
+                      << " [--dir " << DEFAULT_DIRECTORY << "] [--seed " << DEFAULT_SEED << "]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<std::size_t> sizes;
+    std::istringstream sizes_stream (sizes_argument);
+    for(std::string size; std::getline(sizes_stream, size, ',');)
+    {
+        long value (std::atol(size.c_str()));
+        if(value <= 0)
+        {
+            std::cerr << "Invalid size: " << size << std::endl;
+            return 1;
+        }
+        sizes.push_back(value);
+    }
+
+    std::vector<Measurement> results;
+    for(auto it (sizes.begin()); it != sizes.end(); it++)
+        benchmark(*it, directory + "/plantdb_benchmark.db", seed, results);
+
+    std::ofstream out (output);
+    write_json(out, results, seed);
+    if(out.fail())
+    {
+        std::cerr << "Failed to write results: " << output << std::endl;
+        return 1;
+    }
+    std::cerr << "Results written to " << output << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "plant_db_generator.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+static void usage(const char * program)
+{
+    std::cerr << "Usage: " << program << " <db_file> <species> [--seed " << DEFAULT_GENERATOR_SEED << "] [--batch 10000]"
+              << " [--trait <trait>=<uniform|normal|lognormal>:<a>:<b>]..." << std::endl
+              << "Traits:";
+    for(int trait (0); trait < PlantDBGenerator::TRAIT_COUNT; trait++)
+        std::cerr << " " << PlantDBGenerator::traitName(static_cast<PlantDBGenerator::Trait>(trait));
+    std::cerr << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc < 3)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    long count (std::atol(argv[2]));
+    if(count <= 0)
+    {
+        std::cerr << "Invalid species count: " << argv[2] << std::endl;
+        return 1;
+    }
+
+    unsigned seed (DEFAULT_GENERATOR_SEED);
+    long batch_size (10000);
+    std::vector<std::string> traits;
+    for(int i (3); i < argc; i++)
+    {
+        std::string argument (argv[i]);
+        if(i + 1 < argc && argument == "--seed")
+            seed = std::strtoul(argv[++i], NULL, 10);
+        else if(i + 1 < argc && argument == "--batch")
+            batch_size = std::atol(argv[++i]);
+        else if(i + 1 < argc && argument == "--trait")
+            traits.push_back(argv[++i]);
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if(batch_size <= 0)
+    {
+        std::cerr << "Invalid batch size: " << batch_size << std::endl;
+        return 1;
+    }
+
+    PlantDBGenerator generator (seed);
+    for(auto it (traits.begin()); it != traits.end(); it++)
+    {
+        if(!generator.setDistribution(*it))
+        {
+            std::cerr << "Invalid trait distribution: " << *it << std::endl;
+            return 1;
+        }
+    }
+
+    // A new db has nothing to lose if the process dies half-way, so it is filled in bulk load mode
+    bool new_db (!std::ifstream(argv[1]).good());
+
+    std::chrono::steady_clock::time_point start (std::chrono::steady_clock::now());
+    PlantDB plant_db (argv[1], new_db ? PlantDB::BULK_LOAD_MODE : PlantDB::DEFAULT_MODE);
+    generator.populate(plant_db, count, batch_size);
+    double seconds (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+    std::cout << "Generated " << count << " species"
+              << " in " << seconds << " s"
+              << " [" << (seconds > 0 ? count / seconds : 0) << " rows/s]" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include "plant_db_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+
+// Ranges accepted by the editor
+#define VALID_ILLUMINATION_MIN 0
+#define VALID_ILLUMINATION_MAX 24
+#define VALID_SOIL_HUMIDITY_MIN 0
+#define VALID_SOIL_HUMIDITY_MAX 1000
+#define VALID_TEMPERATURE_MIN -50
+#define VALID_TEMPERATURE_MAX 50
+#define VALID_SLOPE_MIN 0
+#define VALID_SLOPE_MAX 90
+#define VALID_GROWTH_MIN 0
+#define VALID_GROWTH_MAX 10000
+#define VALID_AGE_MIN 1
+#define VALID_AGE_MAX 10000
+#define VALID_SEED_DISTANCE_MIN 1
+#define VALID_SEED_DISTANCE_MAX 100
+#define VALID_SEED_COUNT_MIN 0
+#define VALID_SEED_COUNT_MAX 5000
+
+static const char * trait_names[PlantDBGenerator::TRAIT_COUNT] = {
+    "illumination.optimum",
+    "illumination.tolerance",
+    "soil_humidity.optimum",
+    "soil_humidity.tolerance",
+    "temperature.optimum",
+    "temperature.tolerance",
+    "slope.max",
+    "growth.max_height",
+    "growth.max_root_size",
+    "growth.max_canopy_width",
+    "ageing.max_age",
+    "seeding.max_seed_distance",
+    "seeding.seed_count"
+};
+
+static int clamp(double value, int min, int max)
+{
+    return std::min(max, std::max(min, static_cast<int>(std::lround(value))));
+}
+
+PlantDBGenerator::Distribution::Distribution(Type p_type, double p_a, double p_b) :
+    type(p_type), a(p_a), b(p_b)
+{
+
+}
+
+PlantDBGenerator::PlantDBGenerator(unsigned seed) :
+    m_rng(seed), m_generated(0)
+{
+    m_distributions[ILLUMINATION_OPTIMUM] = Distribution(Distribution::NORMAL, 12, 3); // hours
+    m_distributions[ILLUMINATION_TOLERANCE] = Distribution(Distribution::NORMAL, 5, 2);
+    m_distributions[SOIL_HUMIDITY_OPTIMUM] = Distribution(Distribution::NORMAL, 400, 150);
+    m_distributions[SOIL_HUMIDITY_TOLERANCE] = Distribution(Distribution::NORMAL, 200, 80);
+    m_distributions[TEMPERATURE_OPTIMUM] = Distribution(Distribution::NORMAL, 18, 8); // degrees celsius
+    m_distributions[TEMPERATURE_TOLERANCE] = Distribution(Distribution::NORMAL, 12, 4);
+    m_distributions[SLOPE_MAX] = Distribution(Distribution::UNIFORM, 10, 90); // degrees
+    m_distributions[GROWTH_MAX_HEIGHT] = Distribution(Distribution::LOG_NORMAL, 1.6, 0.8); // cm per month, median 5
+    m_distributions[GROWTH_MAX_ROOT_SIZE] = Distribution(Distribution::LOG_NORMAL, 1.2, 0.8); // median 3.3
+    m_distributions[GROWTH_MAX_CANOPY_WIDTH] = Distribution(Distribution::LOG_NORMAL, 1.4, 0.8); // median 4
+    m_distributions[AGEING_MAX_AGE] = Distribution(Distribution::LOG_NORMAL, 5.5, 0.9); // months, median 20 years
+    m_distributions[SEEDING_MAX_SEED_DISTANCE] = Distribution(Distribution::LOG_NORMAL, 2.5, 0.8); // median 12
+    m_distributions[SEEDING_SEED_COUNT] = Distribution(Distribution::LOG_NORMAL, 4.5, 1.2); // median 90
+}
+
+void PlantDBGenerator::setDistribution(Trait trait, const Distribution & distribution)
+{
+    m_distributions[trait] = distribution;
+}
+
+bool PlantDBGenerator::setDistribution(const std::string & specification)
+{
+    std::size_t equals (specification.find('='));
+    if(equals == std::string::npos)
+        return false;
+
+    std::string name (specification.substr(0, equals));
+    int trait (std::find_if(trait_names, trait_names + TRAIT_COUNT, [&name](const char * n) { return name == n; }) - trait_names);
+    if(trait == TRAIT_COUNT)
+        return false;
+
+    std::istringstream parameters (specification.substr(equals + 1));
+    std::string type, a, b;
+    if(!std::getline(parameters, type, ':') || !std::getline(parameters, a, ':') || !std::getline(parameters, b))
+        return false;
+
+    Distribution distribution (Distribution::UNIFORM, std::atof(a.c_str()), std::atof(b.c_str()));
+    if(type == "uniform")
+        distribution.type = Distribution::UNIFORM;
+    else if(type == "normal")
+        distribution.type = Distribution::NORMAL;
+    else if(type == "lognormal")
+        distribution.type = Distribution::LOG_NORMAL;
+    else
+        return false;
+
+    // The standard distributions are undefined for these parameters
+    if(!std::isfinite(distribution.a) || !std::isfinite(distribution.b) ||
+            (distribution.type == Distribution::UNIFORM ? distribution.a > distribution.b : distribution.b <= 0))
+        return false;
+
+    setDistribution(static_cast<Trait>(trait), distribution);
+    return true;
+}
+
+const PlantDBGenerator::Distribution & PlantDBGenerator::distribution(Trait trait) const
+{
+    return m_distributions[trait];
+}
+
+const char * PlantDBGenerator::traitName(Trait trait)
+{
+    return trait_names[trait];
+}
+
+SpecieProperties PlantDBGenerator::generate()
+{
+    double illumination (draw(ILLUMINATION_OPTIMUM)), illumination_tolerance (std::abs(draw(ILLUMINATION_TOLERANCE)));
+    double illumination_prime (illumination_tolerance * fraction(.2, .7));
+    double humidity (draw(SOIL_HUMIDITY_OPTIMUM)), humidity_tolerance (std::abs(draw(SOIL_HUMIDITY_TOLERANCE)));
+    double humidity_prime (humidity_tolerance * fraction(.2, .7));
+    double temperature (draw(TEMPERATURE_OPTIMUM)), temperature_tolerance (std::abs(draw(TEMPERATURE_TOLERANCE)));
+    double temperature_prime (temperature_tolerance * fraction(.2, .7));
+
+    int slope_max (clamp(draw(SLOPE_MAX), VALID_SLOPE_MIN, VALID_SLOPE_MAX));
+    int max_age (clamp(draw(AGEING_MAX_AGE), VALID_AGE_MIN, VALID_AGE_MAX));
+
+    float max_height (clamp(draw(GROWTH_MAX_HEIGHT), VALID_GROWTH_MIN, VALID_GROWTH_MAX));
+    float max_root_size (clamp(draw(GROWTH_MAX_ROOT_SIZE), VALID_GROWTH_MIN, VALID_GROWTH_MAX));
+    float max_canopy_width (clamp(draw(GROWTH_MAX_CANOPY_WIDTH), VALID_GROWTH_MIN, VALID_GROWTH_MAX));
+
+    return SpecieProperties(QString("Specie %1").arg(m_generated++), -1,
+                            AgeingProperties(clamp(max_age * fraction(.3, .9), VALID_AGE_MIN, max_age), max_age),
+                            GrowthProperties(max_height, max_root_size, max_canopy_width),
+                            IlluminationProperties(Range(clamp(illumination - illumination_prime, VALID_ILLUMINATION_MIN, VALID_ILLUMINATION_MAX),
+                                                         clamp(illumination + illumination_prime, VALID_ILLUMINATION_MIN, VALID_ILLUMINATION_MAX)),
+                                                   clamp(illumination - illumination_tolerance, VALID_ILLUMINATION_MIN, VALID_ILLUMINATION_MAX),
+                                                   clamp(illumination + illumination_tolerance, VALID_ILLUMINATION_MIN, VALID_ILLUMINATION_MAX)),
+                            SoilHumidityProperties(Range(clamp(humidity - humidity_prime, VALID_SOIL_HUMIDITY_MIN, VALID_SOIL_HUMIDITY_MAX),
+                                                         clamp(humidity + humidity_prime, VALID_SOIL_HUMIDITY_MIN, VALID_SOIL_HUMIDITY_MAX)),
+                                                   clamp(humidity - humidity_tolerance, VALID_SOIL_HUMIDITY_MIN, VALID_SOIL_HUMIDITY_MAX),
+                                                   clamp(humidity + humidity_tolerance, VALID_SOIL_HUMIDITY_MIN, VALID_SOIL_HUMIDITY_MAX)),
+                            TemperatureProperties(Range(clamp(temperature - temperature_prime, VALID_TEMPERATURE_MIN, VALID_TEMPERATURE_MAX),
+                                                        clamp(temperature + temperature_prime, VALID_TEMPERATURE_MIN, VALID_TEMPERATURE_MAX)),
+                                                  clamp(temperature - temperature_tolerance, VALID_TEMPERATURE_MIN, VALID_TEMPERATURE_MAX),
+                                                  clamp(temperature + temperature_tolerance, VALID_TEMPERATURE_MIN, VALID_TEMPERATURE_MAX)),
+                            SeedingProperties(clamp(draw(SEEDING_MAX_SEED_DISTANCE), VALID_SEED_DISTANCE_MIN, VALID_SEED_DISTANCE_MAX),
+                                              clamp(draw(SEEDING_SEED_COUNT), VALID_SEED_COUNT_MIN, VALID_SEED_COUNT_MAX)),
+                            SlopeProperties(clamp(slope_max * fraction(.3, .9), VALID_SLOPE_MIN, slope_max), slope_max));
+}
+
+std::vector<SpecieProperties> PlantDBGenerator::generate(std::size_t count)
+{
+    std::vector<SpecieProperties> species;
+    species.reserve(count);
+    for(std::size_t i (0); i < count; i++)
+        species.push_back(generate());
+    return species;
+}
+
+void PlantDBGenerator::populate(PlantDB & plant_db, std::size_t count, std::size_t batch_size)
+{
+    batch_size = std::max<std::size_t>(1, batch_size);
+    for(std::size_t inserted (0); inserted < count; inserted += batch_size)
+    {
+        std::vector<SpecieProperties> batch (generate(std::min(batch_size, count - inserted)));
+        plant_db.insertNewPlantData(batch);
+    }
+}
+
+double PlantDBGenerator::draw(Trait trait)
+{
+    const Distribution & distribution (m_distributions[trait]);
+    switch(distribution.type)
+    {
+    case Distribution::NORMAL:
+        return std::normal_distribution<double>(distribution.a, distribution.b)(m_rng);
+    case Distribution::LOG_NORMAL:
+        return std::lognormal_distribution<double>(distribution.a, distribution.b)(m_rng);
+    default:
+        return std::uniform_real_distribution<double>(distribution.a, distribution.b)(m_rng);
+    }
+}
+
+double PlantDBGenerator::fraction(double min, double max)
+{
+    return std::uniform_real_distribution<double>(min, max)(m_rng);
+}
@@ -0,0 +1,79 @@
+#ifndef PLANT_DB_GENERATOR_H
+#define PLANT_DB_GENERATOR_H
+
+#include "plant_db.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#define DEFAULT_GENERATOR_SEED 42
+
+/*
+ * Generates synthetic species, named "Specie <n>", with traits drawn from configurable distributions
+ * and clamped to the ranges accepted by the editor.
+ *
+ * Each environmental envelope is drawn as an optimum and a tolerance (half the width of [min,max]); the
+ * prime range is a random fraction of the tolerance around the optimum. The start of decline of slope
+ * and ageing is a random fraction of their max.
+ *
+ * The same seed generates the same species (with the same standard library).
+ */
+class PlantDBGenerator {
+public:
+    enum Trait{
+        ILLUMINATION_OPTIMUM = 0,
+        ILLUMINATION_TOLERANCE,
+        SOIL_HUMIDITY_OPTIMUM,
+        SOIL_HUMIDITY_TOLERANCE,
+        TEMPERATURE_OPTIMUM,
+        TEMPERATURE_TOLERANCE,
+        SLOPE_MAX,
+        GROWTH_MAX_HEIGHT,
+        GROWTH_MAX_ROOT_SIZE,
+        GROWTH_MAX_CANOPY_WIDTH,
+        AGEING_MAX_AGE,
+        SEEDING_MAX_SEED_DISTANCE,
+        SEEDING_SEED_COUNT,
+        TRAIT_COUNT
+    };
+
+    struct Distribution{
+        enum Type{
+            UNIFORM, // a: min, b: max
+            NORMAL, // a: mean, b: standard deviation
+            LOG_NORMAL // a, b: mean and standard deviation of the log
+        };
+
+        Type type;
+        double a;
+        double b;
+
+        Distribution(Type p_type = UNIFORM, double p_a = 0, double p_b = 1);
+    };
+
+    PlantDBGenerator(unsigned seed = DEFAULT_GENERATOR_SEED);
+
+    void setDistribution(Trait trait, const Distribution & distribution);
+    // "<trait>=<uniform|normal|lognormal>:<a>:<b>". False if malformed, or if a > b (uniform) or b <= 0 (normal, lognormal)
+    bool setDistribution(const std::string & specification);
+    const Distribution & distribution(Trait trait) const;
+
+    static const char * traitName(Trait trait); // e.g. "temperature.optimum"
+
+    SpecieProperties generate();
+    std::vector<SpecieProperties> generate(std::size_t count);
+
+    // Inserts count new species, batch_size per transaction
+    void populate(PlantDB & plant_db, std::size_t count, std::size_t batch_size = 10000);
+
+private:
+    double draw(Trait trait);
+    double fraction(double min, double max);
+
+    std::mt19937 m_rng;
+    Distribution m_distributions[TRAIT_COUNT];
+    long m_generated;
+};
+
+#endif // PLANT_DB_GENERATOR_H
@@ -0,0 +1,31 @@
+#include "plant_db_importer.h"
+
+#include <cstdlib>
+#include <iostream>
+
+int main(int argc, char *argv[])
+{
+    if(argc < 2 || argc > 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <catalogue.csv|catalogue.json|catalogue.jsonl> [batch_size]" << std::endl;
+        return 1;
+    }
+
+    int batch_size (argc == 3 ? std::atoi(argv[2]) : 10000);
+    if(batch_size <= 0)
+    {
+        std::cerr << "Invalid batch size: " << argv[2] << std::endl;
+        return 1;
+    }
+
+    PlantDB plant_db;
+    PlantDBImporter importer(plant_db, batch_size);
+    PlantDBImporter::Report report (importer.importFile(argv[1]));
+
+    std::cout << "Imported " << report.imported_rows << " species"
+              << " (" << report.rejected_rows << " rejected)"
+              << " in " << report.seconds << " s"
+              << " [" << report.rowsPerSecond() << " rows/s]" << std::endl;
+
+    return report.rejected_rows == 0 && report.imported_rows > 0 ? 0 : 1;
+}
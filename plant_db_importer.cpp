@@ -0,0 +1,401 @@
+#include "plant_db_importer.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+
+/****************
+ * FIELD ACCESS *
+ ****************/
+static std::string field_name(const std::string & table_name, const Column & column)
+{
+    return table_name + "." + column.name;
+}
+
+/*
+ * Gives access to the fields of a single record, independently of the format it was read from.
+ */
+class FieldReader {
+public:
+    virtual ~FieldReader() {}
+    virtual bool text(const Column & column, QString & value) const = 0;
+    virtual bool real(const std::string & table_name, const Column & column, double & value) const = 0;
+
+    bool integer(const std::string & table_name, const Column & column, int & value) const
+    {
+        // Casting a double outside of the int range is undefined, so the range is checked first
+        double v;
+        if(!real(table_name, column, v) || !(v >= std::numeric_limits<int>::min() && v <= std::numeric_limits<int>::max()) ||
+                v != std::floor(v))
+            return false;
+        value = static_cast<int>(v);
+        return true;
+    }
+
+    bool real(const std::string & table_name, const Column & column, float & value) const
+    {
+        double v;
+        if(!real(table_name, column, v) || !(std::abs(v) <= std::numeric_limits<float>::max()))
+            return false;
+        value = static_cast<float>(v);
+        return true;
+    }
+};
+
+class CsvFieldReader : public FieldReader {
+public:
+    CsvFieldReader(const std::map<std::string, int> & header, const std::vector<std::string> & fields) :
+        m_header(header), m_fields(fields) {}
+
+    virtual bool text(const Column & column, QString & value) const
+    {
+        const std::string * field (find(column.name));
+        if(field == NULL || field->empty())
+            return false;
+        value = QString::fromUtf8(field->c_str(), field->size());
+        return true;
+    }
+
+    virtual bool real(const std::string & table_name, const Column & column, double & value) const
+    {
+        const std::string * field (find(field_name(table_name, column)));
+        if(field == NULL || field->empty())
+            return false;
+        // strtod accepts "nan", "inf" and overflows to inf: none of them can be stored
+        char * end;
+        value = std::strtod(field->c_str(), &end);
+        return *end == '\0' && std::isfinite(value);
+    }
+
+private:
+    const std::string * find(const std::string & name) const
+    {
+        auto it (m_header.find(name));
+        if(it == m_header.end() || it->second >= static_cast<int>(m_fields.size()))
+            return NULL;
+        return &m_fields[it->second];
+    }
+
+    const std::map<std::string, int> & m_header;
+    const std::vector<std::string> & m_fields;
+};
+
+class JsonFieldReader : public FieldReader {
+public:
+    JsonFieldReader(const QJsonObject & object) : m_object(object) {}
+
+    virtual bool text(const Column & column, QString & value) const
+    {
+        QJsonValue v (m_object.value(QString(column.name.c_str())));
+        if(!v.isString())
+            return false;
+        value = v.toString();
+        return !value.isEmpty();
+    }
+
+    virtual bool real(const std::string & table_name, const Column & column, double & value) const
+    {
+        QJsonValue table (m_object.value(QString(table_name.c_str())));
+        if(!table.isObject())
+            return false;
+        QJsonValue v (table.toObject().value(QString(column.name.c_str())));
+        if(!v.isDouble())
+            return false;
+        value = v.toDouble();
+        return true;
+    }
+
+private:
+    const QJsonObject & m_object;
+};
+
+/*
+ * The suitability of an envelope is only defined if min <= prime_start <= prime_end <= max.
+ */
+static bool valid_envelope(int min, int prime_start, int prime_end, int max)
+{
+    return min <= prime_start && prime_start <= prime_end && prime_end <= max;
+}
+
+/*
+ * Reads every field of a specie. Returns false if any field is missing or malformed, or if the fields of a
+ * property are inconsistent (e.g. a start of decline past the max).
+ */
+static bool read_specie(const FieldReader & reader, std::vector<SpecieProperties> & out)
+{
+    QString name;
+    int ageing_start_of_decline, ageing_max_age;
+    float growth_max_height, growth_max_root_size, growth_max_canopy_width;
+    int illumination_prime_start, illumination_prime_end, illumination_min, illumination_max;
+    int soil_humidity_prime_start, soil_humidity_prime_end, soil_humidity_min, soil_humidity_max;
+    int temp_prime_start, temp_prime_end, temp_min, temp_max;
+    int seeding_max_seeding_distance, seeding_seed_count;
+    int slope_start_of_decline, slope_max;
+
+    bool ok (reader.text(specie_table_column_specie_name, name) &&
+             reader.integer(ageing_properties_table_name, ageing_properties_table_column_start_of_decline, ageing_start_of_decline) &&
+             reader.integer(ageing_properties_table_name, ageing_properties_table_column_max_age, ageing_max_age) &&
+             reader.real(growth_properties_table_name, growth_properties_table_column_max_height, growth_max_height) &&
+             reader.real(growth_properties_table_name, growth_properties_table_column_max_root_size, growth_max_root_size) &&
+             reader.real(growth_properties_table_name, growth_properties_table_column_max_canopy_width, growth_max_canopy_width) &&
+             reader.integer(illumination_properties_table_name, illumination_properties_table_column_prime_start, illumination_prime_start) &&
+             reader.integer(illumination_properties_table_name, illumination_properties_table_column_prime_end, illumination_prime_end) &&
+             reader.integer(illumination_properties_table_name, illumination_properties_table_column_min, illumination_min) &&
+             reader.integer(illumination_properties_table_name, illumination_properties_table_column_max, illumination_max) &&
+             reader.integer(soil_humidity_properties_table_name, soil_humidity_properties_table_column_prime_start, soil_humidity_prime_start) &&
+             reader.integer(soil_humidity_properties_table_name, soil_humidity_properties_table_column_prime_end, soil_humidity_prime_end) &&
+             reader.integer(soil_humidity_properties_table_name, soil_humidity_properties_table_column_min, soil_humidity_min) &&
+             reader.integer(soil_humidity_properties_table_name, soil_humidity_properties_table_column_max, soil_humidity_max) &&
+             reader.integer(temperature_properties_table_name, temperature_properties_table_column_prime_start, temp_prime_start) &&
+             reader.integer(temperature_properties_table_name, temperature_properties_table_column_prime_end, temp_prime_end) &&
+             reader.integer(temperature_properties_table_name, temperature_properties_table_column_min, temp_min) &&
+             reader.integer(temperature_properties_table_name, temperature_properties_table_column_max, temp_max) &&
+             reader.integer(seeding_properties_table_name, seeding_properties_table_column_max_seeding_distance, seeding_max_seeding_distance) &&
+             reader.integer(seeding_properties_table_name, seeding_properties_table_column_seed_count, seeding_seed_count) &&
+             reader.integer(slope_properties_table_name, slope_properties_table_column_start_of_decline, slope_start_of_decline) &&
+             reader.integer(slope_properties_table_name, slope_properties_table_column_max, slope_max));
+
+    if(!ok || !valid_envelope(illumination_min, illumination_prime_start, illumination_prime_end, illumination_max) ||
+            !valid_envelope(soil_humidity_min, soil_humidity_prime_start, soil_humidity_prime_end, soil_humidity_max) ||
+            !valid_envelope(temp_min, temp_prime_start, temp_prime_end, temp_max) ||
+            !(0 <= slope_start_of_decline && slope_start_of_decline <= slope_max) ||
+            !(0 <= ageing_start_of_decline && ageing_start_of_decline <= ageing_max_age))
+        return false;
+
+    out.push_back(SpecieProperties(name,
+                                   AgeingProperties(ageing_start_of_decline, ageing_max_age),
+                                   GrowthProperties(growth_max_height, growth_max_root_size, growth_max_canopy_width),
+                                   IlluminationProperties(Range(illumination_prime_start, illumination_prime_end), illumination_min, illumination_max),
+                                   SoilHumidityProperties(Range(soil_humidity_prime_start, soil_humidity_prime_end), soil_humidity_min, soil_humidity_max),
+                                   TemperatureProperties(Range(temp_prime_start, temp_prime_end), temp_min, temp_max),
+                                   SeedingProperties(seeding_max_seeding_distance, seeding_seed_count),
+                                   SlopeProperties(slope_start_of_decline, slope_max)));
+    return true;
+}
+
+/*
+ * Splits a CSV line into its fields. Double quotes group a field and "" is an escaped quote.
+ */
+static void split_csv_line(const std::string & line, std::vector<std::string> & fields)
+{
+    fields.clear();
+    std::string field;
+    bool quoted (false);
+
+    for(std::size_t i (0); i < line.size(); i++)
+    {
+        char c (line[i]);
+        if(quoted)
+        {
+            if(c == '"' && i+1 < line.size() && line[i+1] == '"')
+                field += line[++i];
+            else if(c == '"')
+                quoted = false;
+            else
+                field += c;
+        }
+        else if(c == '"')
+            quoted = true;
+        else if(c == ',')
+        {
+            fields.push_back(field);
+            field.clear();
+        }
+        else if(c != '\r')
+            field += c;
+    }
+    fields.push_back(field);
+}
+
+/************
+ * IMPORTER *
+ ************/
+PlantDBImporter::Report::Report() :
+    imported_rows(0), rejected_rows(0), seconds(0)
+{
+
+}
+
+double PlantDBImporter::Report::rowsPerSecond() const
+{
+    return seconds > 0 ? imported_rows / seconds : 0;
+}
+
+PlantDBImporter::PlantDBImporter(PlantDB & plant_db, int batch_size) :
+    m_plant_db(plant_db), m_batch_size(batch_size > 0 ? batch_size : 1)
+{
+    m_batch.reserve(m_batch_size);
+}
+
+PlantDBImporter::Report PlantDBImporter::import(std::istream & input, Format format)
+{
+    Report report;
+    auto start (std::chrono::steady_clock::now());
+
+    if(format == CSV)
+        import_csv(input, report);
+    else
+        import_json(input, report);
+
+    flush_batch(report);
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return report;
+}
+
+PlantDBImporter::Report PlantDBImporter::importFile(const std::string & path)
+{
+    Format format;
+    if(!format_from_path(path, format))
+    {
+        std::cerr << "Unknown import format for file: " << path << " (expected .csv, .json or .jsonl)" << std::endl;
+        return Report();
+    }
+
+    std::ifstream input(path, std::ios_base::in);
+    if(input.fail())
+    {
+        std::cerr << "Failed to open import file: " << path << std::endl;
+        return Report();
+    }
+
+    return import(input, format);
+}
+
+bool PlantDBImporter::format_from_path(const std::string & path, Format & format)
+{
+    std::size_t dot (path.rfind('.'));
+    if(dot == std::string::npos)
+        return false;
+
+    std::string extension (path.substr(dot+1));
+    for(auto it (extension.begin()); it != extension.end(); it++)
+        *it = std::tolower(*it);
+
+    if(extension == "csv")
+        format = CSV;
+    else if(extension == "json" || extension == "jsonl")
+        format = JSON;
+    else
+        return false;
+
+    return true;
+}
+
+void PlantDBImporter::import_csv(std::istream & input, Report & report)
+{
+    std::string line;
+    std::vector<std::string> fields;
+    std::map<std::string, int> header;
+
+    // Header
+    if(!std::getline(input, line))
+        return;
+    split_csv_line(line, fields);
+    for(int i (0); i < static_cast<int>(fields.size()); i++)
+        header.emplace(fields[i], i);
+
+    long line_number (1);
+    while(std::getline(input, line))
+    {
+        line_number++;
+        if(line.empty() || line == "\r")
+            continue;
+
+        split_csv_line(line, fields);
+        if(!read_specie(CsvFieldReader(header, fields), m_batch))
+        {
+            std::cerr << "Rejected CSV line " << line_number << ": missing, malformed or inconsistent field" << std::endl;
+            report.rejected_rows++;
+            continue;
+        }
+
+        if(static_cast<int>(m_batch.size()) >= m_batch_size)
+            flush_batch(report);
+    }
+}
+
+void PlantDBImporter::import_json(std::istream & input, Report & report)
+{
+    std::string object;
+    long record_number (0);
+    while(read_json_object(input, object))
+    {
+        record_number++;
+
+        QJsonParseError error;
+        QJsonDocument document (QJsonDocument::fromJson(QByteArray(object.c_str(), object.size()), &error));
+        if(error.error != QJsonParseError::NoError || !document.isObject() ||
+                !read_specie(JsonFieldReader(document.object()), m_batch))
+        {
+            std::cerr << "Rejected JSON record " << record_number << ": missing, malformed or inconsistent field" << std::endl;
+            report.rejected_rows++;
+            continue;
+        }
+
+        if(static_cast<int>(m_batch.size()) >= m_batch_size)
+            flush_batch(report);
+    }
+}
+
+/*
+ * Extracts the next top level JSON object from the stream, skipping the enclosing array
+ * punctuation if any. Only the object being read is held in memory.
+ */
+bool PlantDBImporter::read_json_object(std::istream & input, std::string & object)
+{
+    object.clear();
+
+    int depth (0);
+    bool in_string (false);
+    bool escaped (false);
+    char c;
+    while(input.get(c))
+    {
+        if(depth == 0)
+        {
+            if(c == '{')
+            {
+                object += c;
+                depth++;
+            }
+            continue; // Whitespace, commas and array brackets between objects
+        }
+
+        object += c;
+        if(in_string)
+        {
+            if(escaped)
+                escaped = false;
+            else if(c == '\\')
+                escaped = true;
+            else if(c == '"')
+                in_string = false;
+        }
+        else if(c == '"')
+            in_string = true;
+        else if(c == '{')
+            depth++;
+        else if(c == '}' && --depth == 0)
+            return true;
+    }
+    return false;
+}
+
+void PlantDBImporter::flush_batch(Report & report)
+{
+    if(m_batch.empty())
+        return;
+
+    m_plant_db.insertNewPlantData(m_batch);
+    report.imported_rows += m_batch.size();
+    m_batch.clear();
+}
@@ -0,0 +1,59 @@
+#ifndef PLANT_DB_IMPORTER_H
+#define PLANT_DB_IMPORTER_H
+
+#include "plant_db.h"
+
+#include <istream>
+#include <string>
+#include <vector>
+
+/*
+ * Streams species from a CSV or JSON catalogue into a PlantDB.
+ *
+ * Fields are named after the database layout: "specie_name" followed by "<table>.<column>" for each
+ * property (e.g. "ageing_properties.max_age", "temperature_properties.prime_start").
+ *
+ * CSV: the first line is a header naming the fields (in any order), then one specie per line.
+ *      Quoted fields may contain commas but not line breaks.
+ * JSON: either a top level array of objects or one object per line (JSON lines). Each object holds
+ *       "specie_name" and one nested object per property table, keyed by the table name:
+ *       { "specie_name": "Oak", "ageing_properties": { "start_of_decline": 300, "max_age": 500 }, ... }
+ *
+ * Only one batch of species is ever held in memory. Each batch is written in a single transaction.
+ */
+class PlantDBImporter {
+public:
+    enum Format{
+        CSV,
+        JSON
+    };
+
+    struct Report{
+        long imported_rows;
+        long rejected_rows;
+        double seconds;
+
+        Report();
+        double rowsPerSecond() const;
+    };
+
+    PlantDBImporter(PlantDB & plant_db, int batch_size = 10000);
+
+    Report import(std::istream & input, Format format);
+    Report importFile(const std::string & path); // Format is deduced from the file extension
+
+    static bool format_from_path(const std::string & path, Format & format);
+
+private:
+    void import_csv(std::istream & input, Report & report);
+    void import_json(std::istream & input, Report & report);
+    bool read_json_object(std::istream & input, std::string & object);
+
+    void flush_batch(Report & report);
+
+    PlantDB & m_plant_db;
+    int m_batch_size;
+    std::vector<SpecieProperties> m_batch;
+};
+
+#endif // PLANT_DB_IMPORTER_H
@@ -0,0 +1,315 @@
+#include "plant_db_mapped_snapshot.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(sizeof(MappedSpecie) == 24 * 4, "MappedSpecie must not contain padding");
+static_assert(sizeof(MappedSnapshotHeader) == 48, "MappedSnapshotHeader must not contain padding");
+
+static const char snapshot_magic[8] = "PLANTDB";
+
+static bool write_all(int fd, const char * data, std::size_t size)
+{
+    while(size > 0)
+    {
+        ssize_t written (::write(fd, data, size));
+        if(written < 0 && errno == EINTR)
+            continue;
+        if(written < 0)
+            return false;
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+static std::string parent_directory(const std::string & path)
+{
+    std::size_t slash (path.find_last_of('/'));
+    if(slash == std::string::npos)
+        return ".";
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+/**********
+ * EXPORT *
+ **********/
+bool PlantDBMappedSnapshot::write(PlantDB & plant_db, const std::string & path)
+{
+    return write(plant_db.getAllPlantData(), path);
+}
+
+/*
+ * The snapshot is written next to its destination then renamed over it, so that processes mapping
+ * the previous snapshot never see a partially written file. The file is synced before the rename and
+ * the directory after it, so that a crash cannot publish a snapshot whose content is not on disk yet.
+ */
+bool PlantDBMappedSnapshot::write(const PlantDB::SpeciePropertiesHolder & species, const std::string & path)
+{
+    std::vector<MappedSpecie> records;
+    records.reserve(species.size());
+    std::string names;
+
+    // SpeciePropertiesHolder is ordered by id, hence so are the records
+    for(auto it (species.begin()); it != species.end(); it++)
+    {
+        const SpecieProperties & sp (it->second);
+        QByteArray name (sp.specie_name.toUtf8());
+
+        MappedSpecie record;
+        record.specie_id = sp.specie_id;
+        record.name_offset = names.size();
+        record.name_length = name.size();
+
+        record.ageing_start_of_decline = sp.ageing_properties.start_of_decline;
+        record.ageing_max_age = sp.ageing_properties.max_age;
+
+        record.growth_max_height = sp.growth_properties.max_height;
+        record.growth_max_root_size = sp.growth_properties.max_root_size;
+        record.growth_max_canopy_width = sp.growth_properties.max_canopy_width;
+
+        record.illumination_prime_start = sp.illumination_properties.prime_illumination.first;
+        record.illumination_prime_end = sp.illumination_properties.prime_illumination.second;
+        record.illumination_min = sp.illumination_properties.min_illumination;
+        record.illumination_max = sp.illumination_properties.max_illumination;
+
+        record.soil_humidity_prime_start = sp.soil_humidity_properties.prime_soil_humidity.first;
+        record.soil_humidity_prime_end = sp.soil_humidity_properties.prime_soil_humidity.second;
+        record.soil_humidity_min = sp.soil_humidity_properties.min_soil_humidity;
+        record.soil_humidity_max = sp.soil_humidity_properties.max_soil_humidity;
+
+        record.temperature_prime_start = sp.temperature_properties.prime_temp.first;
+        record.temperature_prime_end = sp.temperature_properties.prime_temp.second;
+        record.temperature_min = sp.temperature_properties.min_temp;
+        record.temperature_max = sp.temperature_properties.max_temp;
+
+        record.seeding_max_seed_distance = sp.seeding_properties.max_seed_distance;
+        record.seeding_seed_count = sp.seeding_properties.seed_count;
+
+        record.slope_start_of_decline = sp.slope_properties.start_of_decline;
+        record.slope_max = sp.slope_properties.max;
+
+        records.push_back(record);
+        names.append(name.constData(), name.size());
+        names.push_back('\0');
+    }
+
+    MappedSnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+    header.format_version = FORMAT_VERSION;
+    header.header_size = sizeof(MappedSnapshotHeader);
+    header.record_size = sizeof(MappedSpecie);
+    header.specie_count = records.size();
+    header.records_offset = sizeof(MappedSnapshotHeader);
+    header.names_offset = header.records_offset + records.size() * sizeof(MappedSpecie);
+    header.names_size = names.size();
+
+    // A unique temporary file, so that concurrent exports to the same path do not truncate each other's
+    std::vector<char> tmp_path_buffer (path.begin(), path.end());
+    const char tmp_suffix[] = ".XXXXXX";
+    tmp_path_buffer.insert(tmp_path_buffer.end(), tmp_suffix, tmp_suffix + sizeof(tmp_suffix));
+    int fd (mkstemp(tmp_path_buffer.data()));
+    std::string tmp_path (tmp_path_buffer.data());
+    if(fd < 0)
+    {
+        std::cerr << "Failed to create species snapshot: " << tmp_path << std::endl;
+        return false;
+    }
+
+    bool written (fchmod(fd, 0644) == 0 && // mkstemp creates the file readable by its owner only
+                  write_all(fd, reinterpret_cast<const char*>(&header), sizeof(header)) &&
+                  write_all(fd, reinterpret_cast<const char*>(records.data()), records.size() * sizeof(MappedSpecie)) &&
+                  write_all(fd, names.data(), names.size()) &&
+                  fsync(fd) == 0);
+    if(::close(fd) != 0)
+        written = false;
+    if(!written)
+    {
+        std::cerr << "Failed to write species snapshot: " << tmp_path << std::endl;
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+
+    if(std::rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+        std::cerr << "Failed to move species snapshot to: " << path << std::endl;
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+
+    int directory_fd (::open(parent_directory(path).c_str(), O_RDONLY | O_DIRECTORY));
+    bool synced (directory_fd >= 0 && fsync(directory_fd) == 0);
+    if(directory_fd >= 0)
+        ::close(directory_fd);
+    if(!synced)
+    {
+        std::cerr << "Failed to sync the directory of species snapshot: " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**********
+ * LOADER *
+ **********/
+PlantDBMappedSnapshot::PlantDBMappedSnapshot() :
+    m_mapping(NULL), m_mapping_size(0), m_records(NULL), m_specie_count(0), m_names(NULL)
+{
+
+}
+
+PlantDBMappedSnapshot::~PlantDBMappedSnapshot()
+{
+    close();
+}
+
+bool PlantDBMappedSnapshot::open(const std::string & path)
+{
+    close();
+
+    int fd (::open(path.c_str(), O_RDONLY));
+    if(fd < 0)
+    {
+        std::cerr << "Failed to open species snapshot: " << path << std::endl;
+        return false;
+    }
+
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) != 0 || file_stat.st_size < static_cast<off_t>(sizeof(MappedSnapshotHeader)))
+    {
+        std::cerr << "Invalid species snapshot: " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    std::size_t size (file_stat.st_size);
+    void * mapping (mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0));
+    ::close(fd); // The mapping keeps the file referenced
+    if(mapping == MAP_FAILED)
+    {
+        std::cerr << "Failed to map species snapshot: " << path << std::endl;
+        return false;
+    }
+
+    const MappedSnapshotHeader * header (static_cast<const MappedSnapshotHeader*>(mapping));
+    bool valid (std::memcmp(header->magic, snapshot_magic, sizeof(header->magic)) == 0 &&
+                header->format_version == FORMAT_VERSION &&
+                header->header_size == sizeof(MappedSnapshotHeader) &&
+                header->record_size == sizeof(MappedSpecie) &&
+                header->records_offset >= sizeof(MappedSnapshotHeader) &&
+                header->records_offset % alignof(MappedSpecie) == 0 &&
+                header->records_offset + static_cast<uint64_t>(header->specie_count) * sizeof(MappedSpecie) <= header->names_offset &&
+                header->names_offset <= size && header->names_size <= size - header->names_offset);
+    if(!valid)
+    {
+        std::cerr << "Incompatible species snapshot: " << path << std::endl;
+        munmap(mapping, size);
+        return false;
+    }
+
+    // Every record is checked once here so that name() and find() can trust them: each name must end with
+    // its NUL inside the pool, and ids must be increasing
+    const MappedSpecie * records (reinterpret_cast<const MappedSpecie*>(static_cast<const char*>(mapping) + header->records_offset));
+    const char * names (static_cast<const char*>(mapping) + header->names_offset);
+    for(uint32_t i (0); i < header->specie_count; i++)
+    {
+        const MappedSpecie & record (records[i]);
+        uint64_t name_end (static_cast<uint64_t>(record.name_offset) + record.name_length);
+        if(name_end >= header->names_size || names[name_end] != '\0' ||
+                (i > 0 && records[i-1].specie_id >= record.specie_id))
+        {
+            std::cerr << "Corrupt species snapshot: " << path << " (record " << i << ")" << std::endl;
+            munmap(mapping, size);
+            return false;
+        }
+    }
+
+    m_mapping = mapping;
+    m_mapping_size = size;
+    m_records = records;
+    m_specie_count = header->specie_count;
+    m_names = names;
+
+    return true;
+}
+
+void PlantDBMappedSnapshot::close()
+{
+    if(m_mapping != NULL)
+        munmap(m_mapping, m_mapping_size);
+
+    m_mapping = NULL;
+    m_mapping_size = 0;
+    m_records = NULL;
+    m_specie_count = 0;
+    m_names = NULL;
+}
+
+bool PlantDBMappedSnapshot::isOpen() const
+{
+    return m_mapping != NULL;
+}
+
+std::size_t PlantDBMappedSnapshot::size() const
+{
+    return m_specie_count;
+}
+
+const MappedSpecie & PlantDBMappedSnapshot::operator[](std::size_t index) const
+{
+    return m_records[index];
+}
+
+const MappedSpecie * PlantDBMappedSnapshot::begin() const
+{
+    return m_records;
+}
+
+const MappedSpecie * PlantDBMappedSnapshot::end() const
+{
+    return m_records + m_specie_count;
+}
+
+const MappedSpecie * PlantDBMappedSnapshot::find(int specie_id) const
+{
+    const MappedSpecie * it (std::lower_bound(begin(), end(), specie_id,
+                                              [](const MappedSpecie & specie, int id) { return specie.specie_id < id; }));
+
+    if(it == end() || it->specie_id != specie_id)
+        return NULL;
+
+    return it;
+}
+
+const char * PlantDBMappedSnapshot::name(const MappedSpecie & specie) const
+{
+    return m_names + specie.name_offset;
+}
+
+SpecieProperties PlantDBMappedSnapshot::toSpecieProperties(const MappedSpecie & specie) const
+{
+    return SpecieProperties(QString::fromUtf8(name(specie), specie.name_length),
+                            specie.specie_id,
+                            AgeingProperties(specie.ageing_start_of_decline, specie.ageing_max_age),
+                            GrowthProperties(specie.growth_max_height, specie.growth_max_root_size, specie.growth_max_canopy_width),
+                            IlluminationProperties(Range(specie.illumination_prime_start, specie.illumination_prime_end),
+                                                   specie.illumination_min, specie.illumination_max),
+                            SoilHumidityProperties(Range(specie.soil_humidity_prime_start, specie.soil_humidity_prime_end),
+                                                   specie.soil_humidity_min, specie.soil_humidity_max),
+                            TemperatureProperties(Range(specie.temperature_prime_start, specie.temperature_prime_end),
+                                                  specie.temperature_min, specie.temperature_max),
+                            SeedingProperties(specie.seeding_max_seed_distance, specie.seeding_seed_count),
+                            SlopeProperties(specie.slope_start_of_decline, specie.slope_max));
+}
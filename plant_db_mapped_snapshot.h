@@ -0,0 +1,102 @@
+#ifndef PLANT_DB_MAPPED_SNAPSHOT_H
+#define PLANT_DB_MAPPED_SNAPSHOT_H
+
+#include "plant_db.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * Fixed layout of a specie in a snapshot file. Every field is 4 bytes wide, in host byte order.
+ */
+struct MappedSpecie {
+    int32_t specie_id;
+    uint32_t name_offset; // Offset of the NUL-terminated, UTF-8 name within the name pool
+    uint32_t name_length; // In bytes, excluding the terminating NUL
+
+    int32_t ageing_start_of_decline;
+    int32_t ageing_max_age;
+
+    float growth_max_height; // cm per month
+    float growth_max_root_size; // cm per month
+    float growth_max_canopy_width; // cm per month
+
+    int32_t illumination_prime_start;
+    int32_t illumination_prime_end;
+    int32_t illumination_min;
+    int32_t illumination_max;
+
+    int32_t soil_humidity_prime_start;
+    int32_t soil_humidity_prime_end;
+    int32_t soil_humidity_min;
+    int32_t soil_humidity_max;
+
+    int32_t temperature_prime_start;
+    int32_t temperature_prime_end;
+    int32_t temperature_min;
+    int32_t temperature_max;
+
+    int32_t seeding_max_seed_distance;
+    int32_t seeding_seed_count;
+
+    int32_t slope_start_of_decline;
+    int32_t slope_max;
+};
+
+/*
+ * File header. The records (sorted by specie id) and the name pool follow at the given offsets.
+ */
+struct MappedSnapshotHeader {
+    char magic[8]; // "PLANTDB"
+    uint32_t format_version;
+    uint32_t header_size;
+    uint32_t record_size;
+    uint32_t specie_count;
+    uint64_t records_offset;
+    uint64_t names_offset;
+    uint64_t names_size;
+};
+
+/*
+ * Read-only view of a binary species snapshot, memory mapped from disk.
+ *
+ * Snapshots are exported from the db with write(). Opening one maps the file and validates its header and
+ * records (name bounds, id order) in a single pass: records are then read in place, without decoding or
+ * allocating anything.
+ */
+class PlantDBMappedSnapshot {
+public:
+    static const uint32_t FORMAT_VERSION = 1;
+
+    static bool write(const PlantDB::SpeciePropertiesHolder & species, const std::string & path);
+    static bool write(PlantDB & plant_db, const std::string & path);
+
+    PlantDBMappedSnapshot();
+    ~PlantDBMappedSnapshot();
+
+    bool open(const std::string & path);
+    void close();
+    bool isOpen() const;
+
+    std::size_t size() const;
+    const MappedSpecie & operator[](std::size_t index) const;
+    const MappedSpecie * begin() const;
+    const MappedSpecie * end() const;
+    const MappedSpecie * find(int specie_id) const; // NULL if there is no such specie
+
+    const char * name(const MappedSpecie & specie) const;
+    SpecieProperties toSpecieProperties(const MappedSpecie & specie) const;
+
+private:
+    PlantDBMappedSnapshot(const PlantDBMappedSnapshot & other);
+    PlantDBMappedSnapshot & operator=(const PlantDBMappedSnapshot & other);
+
+    void * m_mapping;
+    std::size_t m_mapping_size;
+    const MappedSpecie * m_records;
+    std::size_t m_specie_count;
+    const char * m_names;
+};
+
+#endif // PLANT_DB_MAPPED_SNAPSHOT_H
@@ -0,0 +1,120 @@
+#include "plant_db_pool.h"
+#include "settings.h"
+
+#include <algorithm>
+#include <thread>
+
+/**********
+ * READER *
+ **********/
+PlantDBPool::Reader::Reader(PlantDBPool * pool, PlantDB * db) :
+    m_pool(pool), m_db(db)
+{
+
+}
+
+PlantDBPool::Reader::Reader(Reader && other) :
+    m_pool(other.m_pool), m_db(other.m_db)
+{
+    other.m_pool = NULL;
+    other.m_db = NULL;
+}
+
+PlantDBPool::Reader::~Reader()
+{
+    if(m_pool != NULL)
+        m_pool->release(m_db);
+}
+
+/**********
+ * WRITER *
+ **********/
+PlantDBPool::Writer::Writer(std::unique_lock<std::mutex> && lock, PlantDB * db) :
+    m_lock(std::move(lock)), m_db(db)
+{
+
+}
+
+PlantDBPool::Writer::Writer(Writer && other) :
+    m_lock(std::move(other.m_lock)), m_db(other.m_db)
+{
+    other.m_db = NULL;
+}
+
+/********
+ * POOL *
+ ********/
+PlantDBPool::PlantDBPool(int max_readers, int open_flags) :
+    PlantDBPool(Settings::db_file(), max_readers, open_flags)
+{
+
+}
+
+PlantDBPool::PlantDBPool(const std::string & db_file, int max_readers, int open_flags) :
+    m_db_file(db_file),
+    m_open_flags(open_flags),
+    m_max_readers(max_readers > 0 ? max_readers : std::max(1u, std::thread::hardware_concurrency())),
+    m_writer(new PlantDB(db_file, open_flags | PlantDB::WAL_MODE)), // Opened first so that the db is in WAL mode before any reader
+    m_opened_readers(0)
+{
+
+}
+
+PlantDBPool::Reader PlantDBPool::acquireReader()
+{
+    std::unique_lock<std::mutex> lock(m_readers_mutex);
+
+    while(m_available_readers.empty())
+    {
+        if(m_opened_readers < m_max_readers)
+        {
+            // The slot is taken under the lock, the connection is opened outside of it so that the other
+            // threads can keep borrowing and returning readers meanwhile
+            m_opened_readers++;
+            lock.unlock();
+
+            std::unique_ptr<PlantDB> reader;
+            try
+            {
+                reader.reset(new PlantDB(m_db_file, m_open_flags | PlantDB::READ_ONLY_MODE)); // The writer switched the db to WAL
+            }
+            catch(...)
+            {
+                lock.lock();
+                m_opened_readers--;
+                lock.unlock();
+                m_reader_returned.notify_one();
+                throw;
+            }
+
+            lock.lock();
+            m_readers.push_back(std::move(reader));
+            return Reader(this, m_readers.back().get());
+        }
+        m_reader_returned.wait(lock);
+    }
+
+    PlantDB * reader (m_available_readers.back());
+    m_available_readers.pop_back();
+
+    return Reader(this, reader);
+}
+
+PlantDBPool::Writer PlantDBPool::acquireWriter()
+{
+    return Writer(std::unique_lock<std::mutex>(m_writer_mutex), m_writer.get());
+}
+
+int PlantDBPool::maxReaders() const
+{
+    return m_max_readers;
+}
+
+void PlantDBPool::release(PlantDB * reader)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_readers_mutex);
+        m_available_readers.push_back(reader);
+    }
+    m_reader_returned.notify_one();
+}
@@ -0,0 +1,96 @@
+#ifndef PLANT_DB_POOL_H
+#define PLANT_DB_POOL_H
+
+#include "plant_db.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * Hands out PlantDB connections to concurrent threads. The database is switched to write-ahead
+ * logging so that any number of borrowed readers keep working while the (single) writer commits.
+ *
+ * Read connections are opened lazily, up to max_readers. When all of them are borrowed,
+ * acquireReader() blocks until one is returned. Readers are opened in READ_ONLY_MODE and only give
+ * access to the const (read) API of PlantDB: changes go through the writer, which only one thread
+ * at a time may hold.
+ *
+ * Connections are opened in EXCEPTION_MODE by default: an operation still blocked by another connection
+ * after the busy timeout throws a PlantDBException whose busy() is true, and can be tried again, rather
+ * than exiting the process.
+ *
+ * Connections are returned to the pool when the Reader/Writer handle goes out of scope:
+ *
+ *   {
+ *       PlantDBPool::Reader reader (pool.acquireReader());
+ *       PlantDB::SpeciePropertiesHolder species (reader->getAllPlantData());
+ *   }
+ */
+class PlantDBPool {
+public:
+    class Reader {
+    public:
+        Reader(Reader && other);
+        ~Reader();
+        const PlantDB & operator*() const { return *m_db; }
+        const PlantDB * operator->() const { return m_db; }
+
+    private:
+        friend class PlantDBPool;
+        Reader(PlantDBPool * pool, PlantDB * db);
+        Reader(const Reader & other);
+        Reader & operator=(const Reader & other);
+
+        PlantDBPool * m_pool;
+        PlantDB * m_db;
+    };
+
+    class Writer {
+    public:
+        Writer(Writer && other);
+        PlantDB & operator*() const { return *m_db; }
+        PlantDB * operator->() const { return m_db; }
+
+    private:
+        friend class PlantDBPool;
+        Writer(std::unique_lock<std::mutex> && lock, PlantDB * db);
+        Writer(const Writer & other);
+        Writer & operator=(const Writer & other);
+
+        std::unique_lock<std::mutex> m_lock;
+        PlantDB * m_db;
+    };
+
+    // max_readers 0: one reader per hardware thread. The connections are opened with open_flags, plus WAL_MODE
+    // for the writer and READ_ONLY_MODE for the readers
+    PlantDBPool(int max_readers = 0, int open_flags = PlantDB::EXCEPTION_MODE); // Opens Settings::db_file()
+    PlantDBPool(const std::string & db_file, int max_readers = 0, int open_flags = PlantDB::EXCEPTION_MODE);
+
+    Reader acquireReader();
+    Writer acquireWriter();
+
+    int maxReaders() const;
+
+private:
+    PlantDBPool(const PlantDBPool & other);
+    PlantDBPool & operator=(const PlantDBPool & other);
+
+    void release(PlantDB * reader);
+
+    std::string m_db_file;
+    int m_open_flags;
+    int m_max_readers;
+    std::unique_ptr<PlantDB> m_writer;
+    std::mutex m_writer_mutex;
+
+    int m_opened_readers; // Including the ones being opened
+    std::vector<std::unique_ptr<PlantDB> > m_readers; // Every reader opened so far
+    std::vector<PlantDB*> m_available_readers;
+    std::mutex m_readers_mutex;
+    std::condition_variable m_reader_returned;
+};
+
+#endif // PLANT_DB_POOL_H
@@ -0,0 +1,99 @@
+#include "plant_db_snapshot.h"
+#include "settings.h"
+
+#define DEFAULT_POLL_INTERVAL 1000 // ms
+
+PlantDBSnapshot & PlantDBSnapshot::instance()
+{
+    static PlantDBSnapshot snapshot (Settings::db_file());
+    return snapshot;
+}
+
+PlantDBSnapshot::PlantDBSnapshot(const std::string & db_file, int open_flags) :
+    m_version(0),
+    m_plant_db(db_file, open_flags | PlantDB::EXCEPTION_MODE),
+    m_data_version(m_plant_db.dataVersion()),
+    m_poll_interval(DEFAULT_POLL_INTERVAL),
+    m_stop(false)
+{
+    publish(Snapshot(new PlantDB::SpeciePropertiesHolder(m_plant_db.getAllPlantData())));
+    m_poll_thread = std::thread(&PlantDBSnapshot::poll, this);
+}
+
+PlantDBSnapshot::~PlantDBSnapshot()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_poll_mutex);
+        m_stop = true;
+    }
+    m_poll_condition.notify_one();
+    m_poll_thread.join();
+}
+
+PlantDBSnapshot::Snapshot PlantDBSnapshot::get() const
+{
+    return std::atomic_load(&m_snapshot);
+}
+
+long PlantDBSnapshot::version() const
+{
+    return m_version;
+}
+
+PlantDBSnapshot::Error PlantDBSnapshot::lastError() const
+{
+    return std::atomic_load(&m_last_error);
+}
+
+void PlantDBSnapshot::refresh()
+{
+    std::lock_guard<std::mutex> lock(m_refresh_mutex);
+
+    int data_version (m_plant_db.dataVersion());
+    if(data_version == m_data_version)
+        return;
+
+    // The new snapshot is fully built before being published, readers keep the previous one meanwhile
+    Snapshot snapshot (new PlantDB::SpeciePropertiesHolder(m_plant_db.getAllPlantData()));
+    m_data_version = data_version;
+    publish(snapshot);
+}
+
+void PlantDBSnapshot::setPollInterval(std::chrono::milliseconds poll_interval)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_poll_mutex);
+        m_poll_interval = poll_interval;
+    }
+    m_poll_condition.notify_one();
+}
+
+void PlantDBSnapshot::poll()
+{
+    std::unique_lock<std::mutex> lock(m_poll_mutex);
+    while(!m_stop)
+    {
+        m_poll_condition.wait_for(lock, m_poll_interval);
+        if(m_stop)
+            break;
+
+        lock.unlock();
+        try
+        {
+            refresh();
+            std::atomic_store(&m_last_error, Error());
+        }
+        catch(const PlantDBException & e)
+        {
+            // Keep the last good snapshot and try again at the next poll
+            std::atomic_store(&m_last_error, Error(new PlantDBException(e)));
+        }
+        lock.lock();
+    }
+}
+
+void PlantDBSnapshot::publish(const Snapshot & snapshot)
+{
+    std::atomic_store(&m_snapshot, snapshot);
+    m_version++;
+}
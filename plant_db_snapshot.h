@@ -0,0 +1,64 @@
+#ifndef PLANT_DB_SNAPSHOT_H
+#define PLANT_DB_SNAPSHOT_H
+
+#include "plant_db.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/*
+ * Process-wide, immutable copy of every specie in the db.
+ *
+ * get() hands out a reference-counted snapshot which never changes once published: readers on any thread
+ * keep using it for as long as they hold it, without locking. A background thread polls the db
+ * (PRAGMA data_version) and, when another connection or process has committed a change, loads a new
+ * snapshot and swaps it in atomically. Snapshots already handed out are unaffected.
+ *
+ * The db is only read: it is opened in READ_ONLY_MODE by default, and always in EXCEPTION_MODE so that a failed
+ * poll keeps the last good snapshot rather than exiting. The error of a failed poll is available from lastError()
+ * until a poll succeeds.
+ */
+class PlantDBSnapshot {
+public:
+    typedef std::shared_ptr<const PlantDB::SpeciePropertiesHolder> Snapshot;
+    typedef std::shared_ptr<const PlantDBException> Error;
+
+    PlantDBSnapshot(const std::string & db_file, int open_flags = PlantDB::READ_ONLY_MODE);
+    ~PlantDBSnapshot();
+
+    static PlantDBSnapshot & instance(); // Of Settings::db_file()
+
+    Snapshot get() const;
+    long version() const; // Incremented each time a new snapshot is published
+    Error lastError() const; // Of the last poll, NULL if it succeeded
+
+    void refresh(); // Reloads immediately if the db has changed. Throws a PlantDBException on failure
+    void setPollInterval(std::chrono::milliseconds poll_interval);
+
+private:
+    PlantDBSnapshot(const PlantDBSnapshot & other);
+    PlantDBSnapshot & operator=(const PlantDBSnapshot & other);
+
+    void poll();
+    void publish(const Snapshot & snapshot);
+
+    Snapshot m_snapshot; // Only accessed through std::atomic_load/std::atomic_store
+    std::atomic<long> m_version;
+    Error m_last_error; // Only accessed through std::atomic_load/std::atomic_store
+
+    std::mutex m_refresh_mutex; // Guards the connection below
+    PlantDB m_plant_db;
+    int m_data_version;
+
+    std::mutex m_poll_mutex;
+    std::condition_variable m_poll_condition;
+    std::chrono::milliseconds m_poll_interval;
+    bool m_stop;
+    std::thread m_poll_thread;
+};
+
+#endif // PLANT_DB_SNAPSHOT_H
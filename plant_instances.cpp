@@ -0,0 +1,161 @@
+#include "plant_instances.h"
+
+#include <algorithm>
+#include <cstring>
+
+PlantInstances::PlantInstances(const SpeciesTable & species) :
+    m_buckets(species.size())
+{
+    for(std::size_t i (0); i < species.size(); i++)
+    {
+        Bucket & bucket (m_buckets[i]);
+        bucket.m_height_rate = species.growth_max_height[i];
+        bucket.m_canopy_width_rate = species.growth_max_canopy_width[i];
+        bucket.m_root_size_rate = species.growth_max_root_size[i];
+        bucket.m_max_age = species.ageing_max_age[i];
+
+        // Without any decline, vigour drops from 1 to 0 on the month of max age
+        bucket.m_decline_months = std::max(1, bucket.m_max_age - species.ageing_start_of_decline[i]);
+    }
+}
+
+void PlantInstances::add(std::size_t specie_index, float x, float y, int age, float height, float canopy_width,
+                         float root_size)
+{
+    Bucket & bucket (m_buckets[specie_index]);
+    bucket.age.push_back(age);
+    bucket.height.push_back(height);
+    bucket.canopy_width.push_back(canopy_width);
+    bucket.root_size.push_back(root_size);
+    bucket.x.push_back(x);
+    bucket.y.push_back(y);
+}
+
+std::size_t PlantInstances::size() const
+{
+    std::size_t size (0);
+    for(auto it (m_buckets.begin()); it != m_buckets.end(); it++)
+        size += it->size();
+    return size;
+}
+
+std::size_t PlantInstances::specieCount() const
+{
+    return m_buckets.size();
+}
+
+const PlantInstances::Bucket & PlantInstances::bucket(std::size_t specie_index) const
+{
+    return m_buckets[specie_index];
+}
+
+void PlantInstances::step()
+{
+    for(auto it (m_buckets.begin()); it != m_buckets.end(); it++)
+        it->step();
+}
+
+void PlantInstances::step(WorkStealingPool & pool)
+{
+    pool.run(m_buckets.size(), [this](std::size_t specie_index) {
+        m_buckets[specie_index].step();
+    });
+}
+
+/**********
+ * BUCKET *
+ **********/
+#ifdef __GNUC__
+// GCC/Clang vector extensions, mapped on whatever vector registers the target has
+typedef int32_t int32x4 __attribute__((vector_size(16)));
+typedef float floatx4 __attribute__((vector_size(16)));
+#endif
+
+template <typename Int> static inline Int positive_part(Int value)
+{
+    return value & ~(value >> 31);
+}
+
+/*
+ * Months to max age, clamped to [0, decline_months] with arithmetic only, so that it applies to vectors.
+ */
+template <typename Int> static inline Int months_of_decline_left(Int months_to_max_age, int32_t decline_months)
+{
+    return decline_months - positive_part(decline_months - positive_part(months_to_max_age));
+}
+
+/*
+ * The compiler does not vectorize loops of unknown length at -O2, hence the explicit vectors.
+ */
+void PlantInstances::Bucket::step()
+{
+    std::size_t count (size());
+    int32_t * ages (age.data());
+    float * heights (height.data());
+    float * canopy_widths (canopy_width.data());
+    float * root_sizes (root_size.data());
+    const float decline_scale (1.f / m_decline_months);
+
+    std::size_t i (0);
+#ifdef __GNUC__
+    for(; i + 4 <= count; i += 4)
+    {
+        int32x4 ages_x4;
+        floatx4 heights_x4, canopy_widths_x4, root_sizes_x4;
+        std::memcpy(&ages_x4, ages + i, sizeof(ages_x4));
+        std::memcpy(&heights_x4, heights + i, sizeof(heights_x4));
+        std::memcpy(&canopy_widths_x4, canopy_widths + i, sizeof(canopy_widths_x4));
+        std::memcpy(&root_sizes_x4, root_sizes + i, sizeof(root_sizes_x4));
+
+        floatx4 vigour (__builtin_convertvector(months_of_decline_left(m_max_age - ages_x4, m_decline_months), floatx4) * decline_scale);
+        heights_x4 += m_height_rate * vigour;
+        canopy_widths_x4 += m_canopy_width_rate * vigour;
+        root_sizes_x4 += m_root_size_rate * vigour;
+        ages_x4 += 1;
+
+        std::memcpy(ages + i, &ages_x4, sizeof(ages_x4));
+        std::memcpy(heights + i, &heights_x4, sizeof(heights_x4));
+        std::memcpy(canopy_widths + i, &canopy_widths_x4, sizeof(canopy_widths_x4));
+        std::memcpy(root_sizes + i, &root_sizes_x4, sizeof(root_sizes_x4));
+    }
+#endif
+    for(; i < count; i++)
+    {
+        float vigour (months_of_decline_left(m_max_age - ages[i], m_decline_months) * decline_scale);
+        heights[i] += m_height_rate * vigour;
+        canopy_widths[i] += m_canopy_width_rate * vigour;
+        root_sizes[i] += m_root_size_rate * vigour;
+        ages[i]++;
+    }
+
+    remove_dead();
+}
+
+void PlantInstances::Bucket::remove_dead()
+{
+    std::size_t count (size());
+    for(std::size_t i (0); i < count;)
+    {
+        if(age[i] < m_max_age)
+        {
+            i++;
+            continue;
+        }
+
+        count--;
+        age[i] = age[count];
+        height[i] = height[count];
+        canopy_width[i] = canopy_width[count];
+        root_size[i] = root_size[count];
+        x[i] = x[count];
+        y[i] = y[count];
+    }
+
+    // Shrinking keeps the capacity
+    age.resize(count);
+    height.resize(count);
+    canopy_width.resize(count);
+    root_size.resize(count);
+    x.resize(count);
+    y.resize(count);
+}
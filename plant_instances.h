@@ -0,0 +1,65 @@
+#ifndef PLANT_INSTANCES_H
+#define PLANT_INSTANCES_H
+
+#include "species_table.h"
+#include "work_stealing_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Individual plants, stored as structure-of-arrays buckets: one bucket per specie of a SpeciesTable,
+ * one array per attribute.
+ *
+ * step() ages every plant by a month. A plant grows by its specie's growth rates (cm per month) scaled
+ * by its vigour: 1 until its specie's start of decline, falling linearly to 0 at max age, when it dies
+ * (the same model as GrowthCurves). Each bucket is updated in one vectorized pass over its arrays, and
+ * buckets are updated in parallel. Dead plants are then removed by moving the last plant
+ * of the bucket in their place: the order of plants within a bucket is not preserved, and memory is
+ * neither freed nor reallocated.
+ */
+class PlantInstances {
+public:
+    class Bucket {
+    public:
+        std::size_t size() const { return age.size(); }
+
+        SpeciesTable::Column<int32_t> age; // months
+        SpeciesTable::Column<float> height; // cm
+        SpeciesTable::Column<float> canopy_width; // cm
+        SpeciesTable::Column<float> root_size; // cm
+        SpeciesTable::Column<float> x;
+        SpeciesTable::Column<float> y;
+
+    private:
+        friend class PlantInstances;
+
+        void step();
+        void remove_dead();
+
+        // Specie properties
+        float m_height_rate;
+        float m_canopy_width_rate;
+        float m_root_size_rate;
+        int32_t m_max_age;
+        int32_t m_decline_months;
+    };
+
+    explicit PlantInstances(const SpeciesTable & species);
+
+    void add(std::size_t specie_index, float x, float y, int age = 0, float height = 0, float canopy_width = 0,
+             float root_size = 0);
+
+    std::size_t size() const; // Plants of all species
+    std::size_t specieCount() const;
+    const Bucket & bucket(std::size_t specie_index) const;
+
+    void step();
+    void step(WorkStealingPool & pool);
+
+private:
+    std::vector<Bucket> m_buckets;
+};
+
+#endif // PLANT_INSTANCES_H
@@ -1,12 +1,33 @@
 #include "settings.h"
 #include <QDebug>
 #include <QFile>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 
 const std::string SettingsFileTags::_DB_PATH = "DB_LOCATION=";
 
-const std::string Settings::_DB_FILE = load_db_location();
+static std::mutex db_file_mutex;
+static std::string resolved_db_file; // Empty until resolved
+
+std::string Settings::db_file()
+{
+    std::lock_guard<std::mutex> lock (db_file_mutex);
+    if(resolved_db_file.empty())
+    {
+        const char * environment_db_file (std::getenv(DB_FILE_ENVIRONMENT_VARIABLE));
+        resolved_db_file = (environment_db_file && *environment_db_file) ? environment_db_file : load_db_location();
+    }
+    return resolved_db_file;
+}
+
+void Settings::set_db_file(const std::string & db_file)
+{
+    std::lock_guard<std::mutex> lock (db_file_mutex);
+    resolved_db_file = db_file;
+}
+
 std::string Settings::load_db_location()
 {
     // First try local configuration location
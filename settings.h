@@ -9,11 +9,13 @@ public:
     static const std::string _DB_PATH;
 };
 
-static std::string _DB_FILE = "";
+#define DB_FILE_ENVIRONMENT_VARIABLE "PLANTDB_DB_FILE"
 
 class Settings{
 public:
-    const static std::string _DB_FILE;
+    // Resolved on first use: the path set with set_db_file(), else $PLANTDB_DB_FILE, else the DB_LOCATION of plantdb.conf
+    static std::string db_file();
+    static void set_db_file(const std::string & db_file);
 
     static std::string load_db_location();
 
@@ -21,7 +23,4 @@ private:
     static bool file_exists(const std::string & path);
 };
 
-
-
-
 #endif // SETTINGS_H
@@ -0,0 +1,173 @@
+#include "species_table.h"
+
+SpeciesTable::SpeciesTable()
+{
+
+}
+
+SpeciesTable::SpeciesTable(const PlantDB::SpeciePropertiesHolder & species)
+{
+    reserve(species.size());
+    for(auto it (species.begin()); it != species.end(); it++)
+        append(it->second);
+}
+
+SpeciesTable::SpeciesTable(PlantDB & plant_db) :
+    SpeciesTable(plant_db.getAllPlantData())
+{
+
+}
+
+SpeciesTable::SpeciesTable(const PlantDBMappedSnapshot & snapshot)
+{
+    reserve(snapshot.size());
+    for(auto it (snapshot.begin()); it != snapshot.end(); it++)
+        append(*it);
+}
+
+std::size_t SpeciesTable::size() const
+{
+    return specie_id.size();
+}
+
+int SpeciesTable::index(int id) const
+{
+    auto it (m_specie_id_to_index.find(id));
+    return it == m_specie_id_to_index.end() ? -1 : it->second;
+}
+
+void SpeciesTable::append(const SpecieProperties & specie)
+{
+    m_specie_id_to_index[specie.specie_id] = specie_id.size();
+    specie_id.push_back(specie.specie_id);
+
+    illumination_min.push_back(specie.illumination_properties.min_illumination);
+    illumination_prime_start.push_back(specie.illumination_properties.prime_illumination.first);
+    illumination_prime_end.push_back(specie.illumination_properties.prime_illumination.second);
+    illumination_max.push_back(specie.illumination_properties.max_illumination);
+
+    soil_humidity_min.push_back(specie.soil_humidity_properties.min_soil_humidity);
+    soil_humidity_prime_start.push_back(specie.soil_humidity_properties.prime_soil_humidity.first);
+    soil_humidity_prime_end.push_back(specie.soil_humidity_properties.prime_soil_humidity.second);
+    soil_humidity_max.push_back(specie.soil_humidity_properties.max_soil_humidity);
+
+    temperature_min.push_back(specie.temperature_properties.min_temp);
+    temperature_prime_start.push_back(specie.temperature_properties.prime_temp.first);
+    temperature_prime_end.push_back(specie.temperature_properties.prime_temp.second);
+    temperature_max.push_back(specie.temperature_properties.max_temp);
+
+    slope_start_of_decline.push_back(specie.slope_properties.start_of_decline);
+    slope_max.push_back(specie.slope_properties.max);
+
+    growth_max_height.push_back(specie.growth_properties.max_height);
+    growth_max_root_size.push_back(specie.growth_properties.max_root_size);
+    growth_max_canopy_width.push_back(specie.growth_properties.max_canopy_width);
+
+    ageing_start_of_decline.push_back(specie.ageing_properties.start_of_decline);
+    ageing_max_age.push_back(specie.ageing_properties.max_age);
+
+    seeding_max_seed_distance.push_back(specie.seeding_properties.max_seed_distance);
+    seeding_seed_count.push_back(specie.seeding_properties.seed_count);
+}
+
+void SpeciesTable::append(const MappedSpecie & specie)
+{
+    m_specie_id_to_index[specie.specie_id] = specie_id.size();
+    specie_id.push_back(specie.specie_id);
+
+    illumination_min.push_back(specie.illumination_min);
+    illumination_prime_start.push_back(specie.illumination_prime_start);
+    illumination_prime_end.push_back(specie.illumination_prime_end);
+    illumination_max.push_back(specie.illumination_max);
+
+    soil_humidity_min.push_back(specie.soil_humidity_min);
+    soil_humidity_prime_start.push_back(specie.soil_humidity_prime_start);
+    soil_humidity_prime_end.push_back(specie.soil_humidity_prime_end);
+    soil_humidity_max.push_back(specie.soil_humidity_max);
+
+    temperature_min.push_back(specie.temperature_min);
+    temperature_prime_start.push_back(specie.temperature_prime_start);
+    temperature_prime_end.push_back(specie.temperature_prime_end);
+    temperature_max.push_back(specie.temperature_max);
+
+    slope_start_of_decline.push_back(specie.slope_start_of_decline);
+    slope_max.push_back(specie.slope_max);
+
+    growth_max_height.push_back(specie.growth_max_height);
+    growth_max_root_size.push_back(specie.growth_max_root_size);
+    growth_max_canopy_width.push_back(specie.growth_max_canopy_width);
+
+    ageing_start_of_decline.push_back(specie.ageing_start_of_decline);
+    ageing_max_age.push_back(specie.ageing_max_age);
+
+    seeding_max_seed_distance.push_back(specie.seeding_max_seed_distance);
+    seeding_seed_count.push_back(specie.seeding_seed_count);
+}
+
+void SpeciesTable::reserve(std::size_t size)
+{
+    m_specie_id_to_index.reserve(size);
+    specie_id.reserve(size);
+
+    illumination_min.reserve(size);
+    illumination_prime_start.reserve(size);
+    illumination_prime_end.reserve(size);
+    illumination_max.reserve(size);
+
+    soil_humidity_min.reserve(size);
+    soil_humidity_prime_start.reserve(size);
+    soil_humidity_prime_end.reserve(size);
+    soil_humidity_max.reserve(size);
+
+    temperature_min.reserve(size);
+    temperature_prime_start.reserve(size);
+    temperature_prime_end.reserve(size);
+    temperature_max.reserve(size);
+
+    slope_start_of_decline.reserve(size);
+    slope_max.reserve(size);
+
+    growth_max_height.reserve(size);
+    growth_max_root_size.reserve(size);
+    growth_max_canopy_width.reserve(size);
+
+    ageing_start_of_decline.reserve(size);
+    ageing_max_age.reserve(size);
+
+    seeding_max_seed_distance.reserve(size);
+    seeding_seed_count.reserve(size);
+}
+
+void SpeciesTable::clear()
+{
+    m_specie_id_to_index.clear();
+    specie_id.clear();
+
+    illumination_min.clear();
+    illumination_prime_start.clear();
+    illumination_prime_end.clear();
+    illumination_max.clear();
+
+    soil_humidity_min.clear();
+    soil_humidity_prime_start.clear();
+    soil_humidity_prime_end.clear();
+    soil_humidity_max.clear();
+
+    temperature_min.clear();
+    temperature_prime_start.clear();
+    temperature_prime_end.clear();
+    temperature_max.clear();
+
+    slope_start_of_decline.clear();
+    slope_max.clear();
+
+    growth_max_height.clear();
+    growth_max_root_size.clear();
+    growth_max_canopy_width.clear();
+
+    ageing_start_of_decline.clear();
+    ageing_max_age.clear();
+
+    seeding_max_seed_distance.clear();
+    seeding_seed_count.clear();
+}
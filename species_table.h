@@ -0,0 +1,109 @@
+#ifndef SPECIES_TABLE_H
+#define SPECIES_TABLE_H
+
+#include "plant_db.h"
+#include "plant_db_mapped_snapshot.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+#define SPECIES_TABLE_ALIGNMENT 64 // Cache line, also the widest (AVX-512) vector register
+
+/*
+ * Allocator returning memory aligned on Alignment bytes, so that columns can be loaded with aligned vector instructions.
+ */
+template <typename T, std::size_t Alignment>
+class AlignedAllocator {
+public:
+    typedef T value_type;
+    template <typename U> struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+    AlignedAllocator() {}
+    template <typename U> AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+    T * allocate(std::size_t n)
+    {
+        void * p (NULL);
+        if(posix_memalign(&p, Alignment, n * sizeof(T)) != 0)
+            throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T * p, std::size_t) { free(p); }
+
+    template <typename U> bool operator==(const AlignedAllocator<U, Alignment> &) const { return true; }
+    template <typename U> bool operator!=(const AlignedAllocator<U, Alignment> &) const { return false; }
+};
+
+/*
+ * Structure-of-arrays copy of a set of species: one contiguous, aligned array per property, indexed by
+ * a dense specie index in [0, size()). Scanning a single property across all species only touches that
+ * property's array.
+ *
+ * The environmental envelopes are stored as floats, the type the suitability evaluations work with.
+ * The table is a copy: it does not follow later changes to the db.
+ */
+class SpeciesTable {
+public:
+    template <typename T> using Column = std::vector<T, AlignedAllocator<T, SPECIES_TABLE_ALIGNMENT> >;
+
+    SpeciesTable();
+    explicit SpeciesTable(const PlantDB::SpeciePropertiesHolder & species);
+    explicit SpeciesTable(PlantDB & plant_db);
+    explicit SpeciesTable(const PlantDBMappedSnapshot & snapshot);
+
+    std::size_t size() const;
+    int index(int specie_id) const; // Dense index of the specie, -1 if it is not in the table
+
+    void append(const SpecieProperties & specie);
+    void append(const MappedSpecie & specie);
+    void reserve(std::size_t size);
+    void clear();
+
+    // Index -> specie id
+    Column<int32_t> specie_id;
+
+    // Illumination (hours per day)
+    Column<float> illumination_min;
+    Column<float> illumination_prime_start;
+    Column<float> illumination_prime_end;
+    Column<float> illumination_max;
+
+    // Soil humidity
+    Column<float> soil_humidity_min;
+    Column<float> soil_humidity_prime_start;
+    Column<float> soil_humidity_prime_end;
+    Column<float> soil_humidity_max;
+
+    // Temperature (degrees celsius)
+    Column<float> temperature_min;
+    Column<float> temperature_prime_start;
+    Column<float> temperature_prime_end;
+    Column<float> temperature_max;
+
+    // Slope (degrees)
+    Column<float> slope_start_of_decline;
+    Column<float> slope_max;
+
+    // Growth (cm per month)
+    Column<float> growth_max_height;
+    Column<float> growth_max_root_size;
+    Column<float> growth_max_canopy_width;
+
+    // Ageing (months)
+    Column<int32_t> ageing_start_of_decline;
+    Column<int32_t> ageing_max_age;
+
+    // Seeding
+    Column<int32_t> seeding_max_seed_distance;
+    Column<int32_t> seeding_seed_count;
+
+private:
+    std::unordered_map<int, int> m_specie_id_to_index;
+};
+
+#endif // SPECIES_TABLE_H
@@ -0,0 +1,49 @@
+#include "suitability_evaluator.h"
+
+#include <algorithm>
+
+#define TILE_ALIGNMENT 16 // floats: tiles of cache line aligned arrays start on a cache line
+
+SuitabilityEvaluator::SuitabilityEvaluator(WorkStealingPool & pool, std::size_t tile_size, std::size_t species_block_size) :
+    m_pool(pool),
+    m_tile_size(std::max<std::size_t>(TILE_ALIGNMENT, tile_size / TILE_ALIGNMENT * TILE_ALIGNMENT)),
+    m_species_block_size(std::max<std::size_t>(1, species_block_size))
+{
+
+}
+
+/*
+ * Tasks are numbered tile by tile, so the contiguous range of tasks each worker starts with covers
+ * few tiles.
+ */
+void SuitabilityEvaluator::evaluate(const SpeciesTable & species, const EnvironmentCells & cells, float * out) const
+{
+    std::size_t tile_count ((cells.count + m_tile_size - 1) / m_tile_size);
+    std::size_t block_count ((species.size() + m_species_block_size - 1) / m_species_block_size);
+
+    m_pool.run(tile_count * block_count, [&](std::size_t task) {
+        std::size_t tile_begin ((task / block_count) * m_tile_size);
+        std::size_t block_begin ((task % block_count) * m_species_block_size);
+        std::size_t block_end (std::min(species.size(), block_begin + m_species_block_size));
+
+        EnvironmentCells tile;
+        tile.illumination = cells.illumination + tile_begin;
+        tile.soil_humidity = cells.soil_humidity + tile_begin;
+        tile.temperature = cells.temperature + tile_begin;
+        tile.slope = cells.slope + tile_begin;
+        tile.count = std::min(m_tile_size, cells.count - tile_begin);
+
+        for(std::size_t specie_index (block_begin); specie_index < block_end; specie_index++)
+            SuitabilityKernel::evaluate(species, specie_index, tile, out + specie_index * cells.count + tile_begin);
+    });
+}
+
+std::size_t SuitabilityEvaluator::tileSize() const
+{
+    return m_tile_size;
+}
+
+std::size_t SuitabilityEvaluator::speciesBlockSize() const
+{
+    return m_species_block_size;
+}
@@ -0,0 +1,38 @@
+#ifndef SUITABILITY_EVALUATOR_H
+#define SUITABILITY_EVALUATOR_H
+
+#include "species_table.h"
+#include "suitability_kernel.h"
+#include "work_stealing_pool.h"
+
+#include <cstddef>
+
+#define DEFAULT_TILE_SIZE 16384 // cells: 256 KB of environment, reused by every specie of a block
+#define DEFAULT_SPECIES_BLOCK_SIZE 16
+
+/*
+ * Scores a whole grid against a whole species table on a WorkStealingPool.
+ *
+ * The cells are split into tiles and the species into blocks; each (tile, block) pair is a task. A task
+ * scores the species of its block over its tile, so the tile's environment is loaded once per block.
+ * Tasks write disjoint parts of the output, hence the output does not depend on the number of threads
+ * or on the order the tasks run in.
+ */
+class SuitabilityEvaluator {
+public:
+    SuitabilityEvaluator(WorkStealingPool & pool, std::size_t tile_size = DEFAULT_TILE_SIZE,
+                         std::size_t species_block_size = DEFAULT_SPECIES_BLOCK_SIZE);
+
+    // Same output as SuitabilityKernel::evaluate(): out[specie_index * cells.count + cell]
+    void evaluate(const SpeciesTable & species, const EnvironmentCells & cells, float * out) const;
+
+    std::size_t tileSize() const;
+    std::size_t speciesBlockSize() const;
+
+private:
+    WorkStealingPool & m_pool;
+    std::size_t m_tile_size;
+    std::size_t m_species_block_size;
+};
+
+#endif // SUITABILITY_EVALUATOR_H
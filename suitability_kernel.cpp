@@ -0,0 +1,291 @@
+#include "suitability_kernel.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SUITABILITY_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * Response of a specie to one factor. The ramps are stored as scales rather than widths so that the kernels
+ * multiply instead of divide. A zero width ramp gets a zero scale: it is never evaluated, the cells on it
+ * being either out of range or in the prime range.
+ */
+struct FactorEnvelope {
+    float min;
+    float prime_start;
+    float prime_end;
+    float max;
+    float up_scale;
+    float down_scale;
+};
+
+struct SpecieEnvelope {
+    FactorEnvelope illumination;
+    FactorEnvelope soil_humidity;
+    FactorEnvelope temperature;
+    FactorEnvelope slope;
+};
+
+static FactorEnvelope factor_envelope(float min, float prime_start, float prime_end, float max)
+{
+    FactorEnvelope envelope;
+    envelope.min = min;
+    envelope.prime_start = prime_start;
+    envelope.prime_end = prime_end;
+    envelope.max = max;
+    envelope.up_scale = (prime_start > min ? 1.f / (prime_start - min) : 0.f);
+    envelope.down_scale = (max > prime_end ? 1.f / (max - prime_end) : 0.f);
+    return envelope;
+}
+
+static SpecieEnvelope specie_envelope(const SpeciesTable & species, std::size_t i)
+{
+    // Slope has no lower bound: it is prime from -infinity up to its start of decline
+    const float lowest (-std::numeric_limits<float>::infinity());
+
+    SpecieEnvelope envelope;
+    envelope.illumination = factor_envelope(species.illumination_min[i], species.illumination_prime_start[i],
+                                            species.illumination_prime_end[i], species.illumination_max[i]);
+    envelope.soil_humidity = factor_envelope(species.soil_humidity_min[i], species.soil_humidity_prime_start[i],
+                                             species.soil_humidity_prime_end[i], species.soil_humidity_max[i]);
+    envelope.temperature = factor_envelope(species.temperature_min[i], species.temperature_prime_start[i],
+                                           species.temperature_prime_end[i], species.temperature_max[i]);
+    envelope.slope = factor_envelope(lowest, lowest, species.slope_start_of_decline[i], species.slope_max[i]);
+    return envelope;
+}
+
+/**********
+ * SCALAR *
+ **********/
+static inline float scalar_response(float v, const FactorEnvelope & e)
+{
+    if(!(v >= e.min && v <= e.max))
+        return 0.f;
+    if(v < e.prime_start)
+        return (v - e.min) * e.up_scale;
+    if(v <= e.prime_end)
+        return 1.f;
+    return (e.max - v) * e.down_scale;
+}
+
+static void evaluate_scalar(const SpecieEnvelope & e, const EnvironmentCells & cells, std::size_t begin, float * out)
+{
+    for(std::size_t i (begin); i < cells.count; i++)
+    {
+        float r (scalar_response(cells.illumination[i], e.illumination));
+        r = std::min(r, scalar_response(cells.soil_humidity[i], e.soil_humidity));
+        r = std::min(r, scalar_response(cells.temperature[i], e.temperature));
+        r = std::min(r, scalar_response(cells.slope[i], e.slope));
+        out[i] = r;
+    }
+}
+
+#ifdef SUITABILITY_KERNEL_X86
+/*******
+ * SSE *
+ *******/
+static inline __m128 sse_response(__m128 v, const FactorEnvelope & e)
+{
+    __m128 min (_mm_set1_ps(e.min));
+    __m128 max (_mm_set1_ps(e.max));
+    __m128 prime_start (_mm_set1_ps(e.prime_start));
+
+    __m128 up (_mm_mul_ps(_mm_sub_ps(v, min), _mm_set1_ps(e.up_scale)));
+    __m128 down (_mm_mul_ps(_mm_sub_ps(max, v), _mm_set1_ps(e.down_scale)));
+
+    __m128 rising (_mm_cmplt_ps(v, prime_start));
+    __m128 r (_mm_or_ps(_mm_and_ps(rising, up), _mm_andnot_ps(rising, down)));
+
+    __m128 in_prime (_mm_and_ps(_mm_cmpge_ps(v, prime_start), _mm_cmple_ps(v, _mm_set1_ps(e.prime_end))));
+    r = _mm_or_ps(_mm_and_ps(in_prime, _mm_set1_ps(1.f)), _mm_andnot_ps(in_prime, r));
+
+    __m128 in_range (_mm_and_ps(_mm_cmpge_ps(v, min), _mm_cmple_ps(v, max)));
+    return _mm_and_ps(in_range, r);
+}
+
+static void evaluate_sse(const SpecieEnvelope & e, const EnvironmentCells & cells, float * out)
+{
+    std::size_t i (0);
+    for(; i + 4 <= cells.count; i += 4)
+    {
+        __m128 r (sse_response(_mm_loadu_ps(cells.illumination + i), e.illumination));
+        r = _mm_min_ps(r, sse_response(_mm_loadu_ps(cells.soil_humidity + i), e.soil_humidity));
+        r = _mm_min_ps(r, sse_response(_mm_loadu_ps(cells.temperature + i), e.temperature));
+        r = _mm_min_ps(r, sse_response(_mm_loadu_ps(cells.slope + i), e.slope));
+        _mm_storeu_ps(out + i, r);
+    }
+    evaluate_scalar(e, cells, i, out);
+}
+
+/********
+ * AVX2 *
+ ********/
+__attribute__((target("avx2")))
+static inline __m256 avx2_response(__m256 v, const FactorEnvelope & e)
+{
+    __m256 min (_mm256_set1_ps(e.min));
+    __m256 max (_mm256_set1_ps(e.max));
+    __m256 prime_start (_mm256_set1_ps(e.prime_start));
+
+    __m256 up (_mm256_mul_ps(_mm256_sub_ps(v, min), _mm256_set1_ps(e.up_scale)));
+    __m256 down (_mm256_mul_ps(_mm256_sub_ps(max, v), _mm256_set1_ps(e.down_scale)));
+    __m256 r (_mm256_blendv_ps(down, up, _mm256_cmp_ps(v, prime_start, _CMP_LT_OQ)));
+
+    __m256 in_prime (_mm256_and_ps(_mm256_cmp_ps(v, prime_start, _CMP_GE_OQ),
+                                   _mm256_cmp_ps(v, _mm256_set1_ps(e.prime_end), _CMP_LE_OQ)));
+    r = _mm256_blendv_ps(r, _mm256_set1_ps(1.f), in_prime);
+
+    __m256 in_range (_mm256_and_ps(_mm256_cmp_ps(v, min, _CMP_GE_OQ), _mm256_cmp_ps(v, max, _CMP_LE_OQ)));
+    return _mm256_and_ps(in_range, r);
+}
+
+__attribute__((target("avx2")))
+static void evaluate_avx2(const SpecieEnvelope & e, const EnvironmentCells & cells, float * out)
+{
+    std::size_t i (0);
+    for(; i + 8 <= cells.count; i += 8)
+    {
+        __m256 r (avx2_response(_mm256_loadu_ps(cells.illumination + i), e.illumination));
+        r = _mm256_min_ps(r, avx2_response(_mm256_loadu_ps(cells.soil_humidity + i), e.soil_humidity));
+        r = _mm256_min_ps(r, avx2_response(_mm256_loadu_ps(cells.temperature + i), e.temperature));
+        r = _mm256_min_ps(r, avx2_response(_mm256_loadu_ps(cells.slope + i), e.slope));
+        _mm256_storeu_ps(out + i, r);
+    }
+    evaluate_scalar(e, cells, i, out);
+}
+
+/***********
+ * AVX-512 *
+ ***********/
+__attribute__((target("avx512f")))
+static inline __m512 avx512_response(__m512 v, const FactorEnvelope & e)
+{
+    __m512 min (_mm512_set1_ps(e.min));
+    __m512 max (_mm512_set1_ps(e.max));
+    __m512 prime_start (_mm512_set1_ps(e.prime_start));
+
+    __m512 up (_mm512_mul_ps(_mm512_sub_ps(v, min), _mm512_set1_ps(e.up_scale)));
+    __m512 down (_mm512_mul_ps(_mm512_sub_ps(max, v), _mm512_set1_ps(e.down_scale)));
+    __m512 r (_mm512_mask_blend_ps(_mm512_cmp_ps_mask(v, prime_start, _CMP_LT_OQ), down, up));
+
+    __mmask16 in_prime (_mm512_cmp_ps_mask(v, prime_start, _CMP_GE_OQ) &
+                        _mm512_cmp_ps_mask(v, _mm512_set1_ps(e.prime_end), _CMP_LE_OQ));
+    r = _mm512_mask_blend_ps(in_prime, r, _mm512_set1_ps(1.f));
+
+    __mmask16 in_range (_mm512_cmp_ps_mask(v, min, _CMP_GE_OQ) & _mm512_cmp_ps_mask(v, max, _CMP_LE_OQ));
+    return _mm512_maskz_mov_ps(in_range, r);
+}
+
+__attribute__((target("avx512f")))
+static void evaluate_avx512(const SpecieEnvelope & e, const EnvironmentCells & cells, float * out)
+{
+    std::size_t i (0);
+    for(; i + 16 <= cells.count; i += 16)
+    {
+        // Full-mask min: _mm512_min_ps passes an undefined source which -Wmaybe-uninitialized reports with GCC 12
+        __m512 r (avx512_response(_mm512_loadu_ps(cells.illumination + i), e.illumination));
+        r = _mm512_mask_min_ps(r, 0xffff, r, avx512_response(_mm512_loadu_ps(cells.soil_humidity + i), e.soil_humidity));
+        r = _mm512_mask_min_ps(r, 0xffff, r, avx512_response(_mm512_loadu_ps(cells.temperature + i), e.temperature));
+        r = _mm512_mask_min_ps(r, 0xffff, r, avx512_response(_mm512_loadu_ps(cells.slope + i), e.slope));
+        _mm512_storeu_ps(out + i, r);
+    }
+    evaluate_scalar(e, cells, i, out);
+}
+#endif // SUITABILITY_KERNEL_X86
+
+/****************************
+ * INTERFACE WITH THE WORLD *
+ ****************************/
+float SuitabilityKernel::response(float value, float min, float prime_start, float prime_end, float max)
+{
+    return scalar_response(value, factor_envelope(min, prime_start, prime_end, max));
+}
+
+float SuitabilityKernel::slopeResponse(float slope, float start_of_decline, float max)
+{
+    const float lowest (-std::numeric_limits<float>::infinity());
+    return scalar_response(slope, factor_envelope(lowest, lowest, start_of_decline, max));
+}
+
+static SuitabilityKernel::InstructionSet detect_instruction_set()
+{
+#ifdef SUITABILITY_KERNEL_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f"))
+        return SuitabilityKernel::AVX512;
+    if(__builtin_cpu_supports("avx2"))
+        return SuitabilityKernel::AVX2;
+    if(__builtin_cpu_supports("sse2"))
+        return SuitabilityKernel::SSE;
+#endif
+    return SuitabilityKernel::SCALAR;
+}
+
+SuitabilityKernel::InstructionSet SuitabilityKernel::supportedInstructionSet()
+{
+    static const InstructionSet supported (detect_instruction_set());
+    return supported;
+}
+
+const char * SuitabilityKernel::instructionSetName(InstructionSet instruction_set)
+{
+    switch(instruction_set)
+    {
+    case SSE:
+        return "SSE";
+    case AVX2:
+        return "AVX2";
+    case AVX512:
+        return "AVX-512";
+    default:
+        return "scalar";
+    }
+}
+
+void SuitabilityKernel::evaluate(const SpeciesTable & species, std::size_t specie_index, const EnvironmentCells & cells,
+                                 float * out)
+{
+    evaluate(species, specie_index, cells, out, supportedInstructionSet());
+}
+
+/*
+ * Instruction sets the CPU does not support fall back to the widest one it does.
+ */
+void SuitabilityKernel::evaluate(const SpeciesTable & species, std::size_t specie_index, const EnvironmentCells & cells,
+                                 float * out, InstructionSet instruction_set)
+{
+    SpecieEnvelope envelope (specie_envelope(species, specie_index));
+
+    switch(std::min(instruction_set, supportedInstructionSet()))
+    {
+#ifdef SUITABILITY_KERNEL_X86
+    case AVX512:
+        evaluate_avx512(envelope, cells, out);
+        break;
+    case AVX2:
+        evaluate_avx2(envelope, cells, out);
+        break;
+    case SSE:
+        evaluate_sse(envelope, cells, out);
+        break;
+#endif
+    default:
+        evaluate_scalar(envelope, cells, 0, out);
+        break;
+    }
+}
+
+void SuitabilityKernel::evaluate(const SpeciesTable & species, const EnvironmentCells & cells, float * out)
+{
+    evaluate(species, cells, out, supportedInstructionSet());
+}
+
+void SuitabilityKernel::evaluate(const SpeciesTable & species, const EnvironmentCells & cells, float * out,
+                                 InstructionSet instruction_set)
+{
+    for(std::size_t i (0); i < species.size(); i++)
+        evaluate(species, i, cells, out + i * cells.count, instruction_set);
+}
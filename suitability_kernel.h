@@ -0,0 +1,57 @@
+#ifndef SUITABILITY_KERNEL_H
+#define SUITABILITY_KERNEL_H
+
+#include "species_table.h"
+
+#include <cstddef>
+
+/*
+ * Environment of a set of terrain cells, one array per factor. All arrays hold count values.
+ */
+struct EnvironmentCells {
+    const float * illumination; // hours per day
+    const float * soil_humidity;
+    const float * temperature; // degrees celsius
+    const float * slope; // degrees
+    std::size_t count;
+};
+
+/*
+ * Scores how suitable terrain cells are for species, in [0,1].
+ *
+ * The response to illumination, soil humidity and temperature is 0 outside [min,max], 1 within the prime
+ * range and linear in between. The response to slope is 1 up to start_of_decline and falls linearly to 0
+ * at max. The suitability of a cell is the lowest of the four responses.
+ *
+ * Cells are evaluated several at a time with the widest vector instructions the CPU supports, detected at
+ * runtime. Every instruction set gives the same results as the scalar implementation.
+ */
+class SuitabilityKernel {
+public:
+    enum InstructionSet {
+        SCALAR = 0,
+        SSE,
+        AVX2,
+        AVX512
+    };
+
+    // Response to a single value of illumination, soil humidity or temperature, and to a single slope
+    static float response(float value, float min, float prime_start, float prime_end, float max);
+    static float slopeResponse(float slope, float start_of_decline, float max);
+
+    static InstructionSet supportedInstructionSet();
+    static const char * instructionSetName(InstructionSet instruction_set);
+
+    // Suitability of every cell for the specie at the given index of the table, written to out[0..cells.count)
+    static void evaluate(const SpeciesTable & species, std::size_t specie_index, const EnvironmentCells & cells,
+                         float * out);
+    static void evaluate(const SpeciesTable & species, std::size_t specie_index, const EnvironmentCells & cells,
+                         float * out, InstructionSet instruction_set);
+
+    // Suitability of every cell for every specie of the table, written species-major: out[specie_index * cells.count + cell]
+    static void evaluate(const SpeciesTable & species, const EnvironmentCells & cells, float * out);
+    static void evaluate(const SpeciesTable & species, const EnvironmentCells & cells, float * out,
+                         InstructionSet instruction_set);
+};
+
+#endif // SUITABILITY_KERNEL_H
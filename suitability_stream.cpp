@@ -0,0 +1,278 @@
+#include "suitability_stream.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static std::size_t page_cells()
+{
+    return sysconf(_SC_PAGESIZE) / sizeof(float);
+}
+
+/*
+ * Read-only mapping of a raster file. Ranges are given in cells; tiles start on page boundaries.
+ */
+class MappedRaster {
+public:
+    MappedRaster() : m_data(NULL), m_size(0) {}
+    ~MappedRaster()
+    {
+        if(m_data != NULL)
+            munmap(m_data, m_size);
+    }
+
+    bool open(const std::string & path)
+    {
+        int fd (::open(path.c_str(), O_RDONLY));
+        if(fd < 0)
+        {
+            std::cerr << "Failed to open raster: " << path << std::endl;
+            return false;
+        }
+
+        struct stat file_stat;
+        if(fstat(fd, &file_stat) != 0 || file_stat.st_size == 0 || file_stat.st_size % sizeof(float) != 0)
+        {
+            std::cerr << "Invalid raster: " << path << std::endl;
+            ::close(fd);
+            return false;
+        }
+
+        m_size = file_stat.st_size;
+        void * data (mmap(NULL, m_size, PROT_READ, MAP_SHARED, fd, 0));
+        ::close(fd); // The mapping keeps the file referenced
+        if(data == MAP_FAILED)
+        {
+            std::cerr << "Failed to map raster: " << path << std::endl;
+            return false;
+        }
+        m_data = data;
+        madvise(m_data, m_size, MADV_SEQUENTIAL);
+
+        return true;
+    }
+
+    const float * data() const { return static_cast<const float*>(m_data); }
+    std::size_t count() const { return m_size / sizeof(float); }
+
+    void willNeed(std::size_t begin, std::size_t count) { advise(begin, count, MADV_WILLNEED); }
+    void dontNeed(std::size_t begin, std::size_t count) { advise(begin, count, MADV_DONTNEED); }
+
+private:
+    MappedRaster(const MappedRaster & other);
+    MappedRaster & operator=(const MappedRaster & other);
+
+    void advise(std::size_t begin, std::size_t count, int advice)
+    {
+        if(begin >= this->count())
+            return;
+        count = std::min(count, this->count() - begin);
+        madvise(static_cast<char*>(m_data) + begin * sizeof(float), count * sizeof(float), advice);
+    }
+
+    void * m_data;
+    std::size_t m_size;
+};
+
+/*
+ * Writes the scores of a tile, one row per specie, on its own thread. write() hands a filled buffer
+ * over and gets back the one written previously, waiting if it is still being written.
+ */
+class TileWriter {
+public:
+    TileWriter(int fd, std::size_t cell_count, std::size_t specie_count) :
+        m_fd(fd), m_cell_count(cell_count), m_specie_count(specie_count),
+        m_tile_begin(0), m_tile_cells(0), m_pending(false), m_stop(false), m_failed(false)
+    {
+        m_thread = std::thread(&TileWriter::work, this);
+    }
+
+    ~TileWriter()
+    {
+        finish();
+    }
+
+    void write(std::vector<float> & buffer, std::size_t tile_begin, std::size_t tile_cells)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_written.wait(lock, [this]() { return !m_pending; });
+        m_buffer.swap(buffer);
+        m_tile_begin = tile_begin;
+        m_tile_cells = tile_cells;
+        m_pending = true;
+        m_submitted.notify_one();
+    }
+
+    // Waits for the last tile to be written. False if any write failed.
+    bool finish()
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_written.wait(lock, [this]() { return !m_pending; });
+            m_stop = true;
+        }
+        m_submitted.notify_one();
+        if(m_thread.joinable())
+            m_thread.join();
+
+        return !m_failed;
+    }
+
+private:
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while(true)
+        {
+            m_submitted.wait(lock, [this]() { return m_pending || m_stop; });
+            if(!m_pending)
+                return;
+
+            lock.unlock();
+            bool written (write_tile());
+            lock.lock();
+
+            m_failed = m_failed || !written;
+            m_pending = false;
+            m_written.notify_one();
+        }
+    }
+
+    bool write_tile()
+    {
+        for(std::size_t specie_index (0); specie_index < m_specie_count; specie_index++)
+        {
+            const char * row (reinterpret_cast<const char*>(&m_buffer[specie_index * m_tile_cells]));
+            std::size_t remaining (m_tile_cells * sizeof(float));
+            off_t offset ((specie_index * m_cell_count + m_tile_begin) * sizeof(float));
+
+            while(remaining > 0)
+            {
+                ssize_t written (pwrite(m_fd, row, remaining, offset));
+                if(written < 0 && errno == EINTR)
+                    continue;
+                if(written <= 0)
+                    return false;
+                row += written;
+                remaining -= written;
+                offset += written;
+            }
+        }
+        return true;
+    }
+
+    int m_fd;
+    std::size_t m_cell_count;
+    std::size_t m_specie_count;
+
+    std::vector<float> m_buffer;
+    std::size_t m_tile_begin;
+    std::size_t m_tile_cells;
+
+    std::mutex m_mutex;
+    std::condition_variable m_submitted;
+    std::condition_variable m_written;
+    bool m_pending;
+    bool m_stop;
+    bool m_failed;
+    std::thread m_thread;
+};
+
+SuitabilityStream::SuitabilityStream(WorkStealingPool & pool, std::size_t memory_budget) :
+    m_pool(pool), m_memory_budget(memory_budget)
+{
+
+}
+
+std::size_t SuitabilityStream::tileSize(std::size_t specie_count) const
+{
+    std::size_t alignment (page_cells());
+    std::size_t tile_size (m_memory_budget / (2 * std::max<std::size_t>(1, specie_count) * sizeof(float)));
+    return tile_size / alignment * alignment; // 0 if a single page of cells does not fit in the budget
+}
+
+bool SuitabilityStream::evaluate(const SpeciesTable & species, const EnvironmentRasterFiles & environment,
+                                 const std::string & output_path)
+{
+    MappedRaster illumination, soil_humidity, temperature, slope;
+    if(!illumination.open(environment.illumination) || !soil_humidity.open(environment.soil_humidity) ||
+            !temperature.open(environment.temperature) || !slope.open(environment.slope))
+        return false;
+
+    std::size_t cell_count (illumination.count());
+    if(soil_humidity.count() != cell_count || temperature.count() != cell_count || slope.count() != cell_count)
+    {
+        std::cerr << "Environment rasters cover different numbers of cells" << std::endl;
+        return false;
+    }
+
+    std::size_t tile_size (tileSize(species.size()));
+    if(tile_size == 0)
+    {
+        std::cerr << "Memory budget of " << m_memory_budget << " bytes is too small for " << species.size()
+                  << " species: at least " << 2 * page_cells() * species.size() * sizeof(float) << " bytes are needed" << std::endl;
+        return false;
+    }
+
+    int fd (::open(output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+    if(fd < 0 || ftruncate(fd, cell_count * species.size() * sizeof(float)) != 0)
+    {
+        std::cerr << "Failed to create suitability output: " << output_path << std::endl;
+        if(fd >= 0)
+            ::close(fd);
+        return false;
+    }
+
+    SuitabilityEvaluator evaluator (m_pool);
+    std::vector<float> buffer (tile_size * species.size());
+    bool written;
+    {
+        TileWriter writer (fd, cell_count, species.size());
+
+        for(std::size_t tile_begin (0); tile_begin < cell_count; tile_begin += tile_size)
+        {
+            std::size_t tile_cells (std::min(tile_size, cell_count - tile_begin));
+            std::size_t next_tile_begin (tile_begin + tile_size);
+
+            illumination.willNeed(next_tile_begin, tile_size);
+            soil_humidity.willNeed(next_tile_begin, tile_size);
+            temperature.willNeed(next_tile_begin, tile_size);
+            slope.willNeed(next_tile_begin, tile_size);
+
+            EnvironmentCells tile;
+            tile.illumination = illumination.data() + tile_begin;
+            tile.soil_humidity = soil_humidity.data() + tile_begin;
+            tile.temperature = temperature.data() + tile_begin;
+            tile.slope = slope.data() + tile_begin;
+            tile.count = tile_cells;
+
+            buffer.resize(tile_cells * species.size());
+            evaluator.evaluate(species, tile, buffer.data());
+            writer.write(buffer, tile_begin, tile_cells);
+
+            illumination.dontNeed(tile_begin, tile_cells);
+            soil_humidity.dontNeed(tile_begin, tile_cells);
+            temperature.dontNeed(tile_begin, tile_cells);
+            slope.dontNeed(tile_begin, tile_cells);
+        }
+
+        written = writer.finish();
+    }
+
+    if(::close(fd) != 0 || !written)
+    {
+        std::cerr << "Failed to write suitability output: " << output_path << std::endl;
+        return false;
+    }
+
+    return true;
+}
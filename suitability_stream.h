@@ -0,0 +1,50 @@
+#ifndef SUITABILITY_STREAM_H
+#define SUITABILITY_STREAM_H
+
+#include "species_table.h"
+#include "suitability_evaluator.h"
+#include "work_stealing_pool.h"
+
+#include <cstddef>
+#include <string>
+
+#define DEFAULT_STREAM_MEMORY_BUDGET (256 * 1024 * 1024) // bytes
+
+/*
+ * Environment rasters on disk: raw, host byte order float32 files holding one value per cell, all
+ * covering the same cells in the same order.
+ */
+struct EnvironmentRasterFiles {
+    std::string illumination;
+    std::string soil_humidity;
+    std::string temperature;
+    std::string slope;
+};
+
+/*
+ * Scores rasters that may not fit in memory against a species table, tile by tile.
+ *
+ * The rasters are memory mapped. While a tile is evaluated, the kernel is asked to read the next one
+ * ahead and the pages of the previous one are dropped. Scores are written by a separate thread while
+ * the next tile is evaluated, to a raw float32 file laid out like SuitabilityKernel's output:
+ * specie_index * cell_count + cell.
+ *
+ * The two output buffers (one being filled, one being written) are sized to fit the memory budget,
+ * which sets the tile size: budget / (2 * species * sizeof(float)) cells, rounded down to a whole number of
+ * pages of cells. The budget is never exceeded: evaluate() fails if not even one page of cells fits in it.
+ */
+class SuitabilityStream {
+public:
+    SuitabilityStream(WorkStealingPool & pool, std::size_t memory_budget = DEFAULT_STREAM_MEMORY_BUDGET);
+
+    bool evaluate(const SpeciesTable & species, const EnvironmentRasterFiles & environment,
+                  const std::string & output_path);
+
+    std::size_t tileSize(std::size_t specie_count) const; // Cells per tile for the given number of species, 0 if none fits
+
+private:
+    WorkStealingPool & m_pool;
+    std::size_t m_memory_budget;
+};
+
+#endif // SUITABILITY_STREAM_H
@@ -0,0 +1,226 @@
+#include "suitability_tables.h"
+
+#include <algorithm>
+#include <vector>
+
+// Each row holds one entry per integer of the domain, then one for the values outside of it
+static const int illumination_width (ILLUMINATION_DOMAIN_MAX - ILLUMINATION_DOMAIN_MIN + 2);
+static const int soil_humidity_width (SOIL_HUMIDITY_DOMAIN_MAX - SOIL_HUMIDITY_DOMAIN_MIN + 2);
+static const int temperature_width (TEMPERATURE_DOMAIN_MAX - TEMPERATURE_DOMAIN_MIN + 2);
+static const int slope_width (SLOPE_DOMAIN_MAX - SLOPE_DOMAIN_MIN + 2);
+
+/*
+ * Offset of the entry for the given value within a row. Values outside the domain, and NaN, map to the
+ * out of domain entry, which scores 0 like the kernel does for them.
+ */
+static inline int quantize(float value, int domain_min, int domain_max)
+{
+    if(!(value >= domain_min && value <= domain_max))
+        return domain_max - domain_min + 1;
+    return static_cast<int>(value - domain_min + .5f);
+}
+
+// Slopes have no lower bound: the kernel scores a negative slope like a flat one
+static inline int quantize_slope(float value)
+{
+    return value < SLOPE_DOMAIN_MIN ? 0 : quantize(value, SLOPE_DOMAIN_MIN, SLOPE_DOMAIN_MAX);
+}
+
+SuitabilityTables::SuitabilityTables()
+{
+
+}
+
+SuitabilityTables::SuitabilityTables(const PlantDB::SpeciePropertiesHolder & species)
+{
+    m_specie_id_to_row.reserve(species.size());
+    resize(species.size());
+
+    std::size_t row (0);
+    for(auto it (species.begin()); it != species.end(); it++, row++)
+    {
+        m_specie_id_to_row[it->first] = row;
+        build_row(row, it->second);
+    }
+}
+
+SuitabilityTables::SuitabilityTables(PlantDB & plant_db) :
+    SuitabilityTables(plant_db.getAllPlantData())
+{
+
+}
+
+std::size_t SuitabilityTables::size() const
+{
+    return m_specie_ids.size();
+}
+
+int SuitabilityTables::index(int specie_id) const
+{
+    auto it (m_specie_id_to_row.find(specie_id));
+    return it == m_specie_id_to_row.end() ? -1 : it->second;
+}
+
+int SuitabilityTables::specieId(std::size_t row) const
+{
+    return m_specie_ids[row];
+}
+
+std::size_t SuitabilityTables::memoryUsage() const
+{
+    return m_specie_ids.capacity() * sizeof(int32_t) +
+            (m_illumination.capacity() + m_soil_humidity.capacity() + m_temperature.capacity() + m_slope.capacity()) * sizeof(float);
+}
+
+/***********
+ * UPDATES *
+ ***********/
+void SuitabilityTables::update(const SpecieProperties & specie)
+{
+    int row (index(specie.specie_id));
+    if(row == -1)
+    {
+        row = size();
+        resize(row + 1);
+        m_specie_id_to_row[specie.specie_id] = row;
+    }
+    build_row(row, specie);
+}
+
+void SuitabilityTables::remove(int specie_id)
+{
+    auto it (m_specie_id_to_row.find(specie_id));
+    if(it == m_specie_id_to_row.end())
+        return;
+
+    std::size_t row (it->second);
+    std::size_t last (size() - 1);
+    m_specie_id_to_row.erase(it);
+
+    if(row != last)
+    {
+        copy_row(last, row);
+        m_specie_id_to_row[m_specie_ids[row]] = row;
+    }
+    resize(last);
+}
+
+void SuitabilityTables::apply(PlantDB & plant_db, int specie_id, PlantDB::ChangeType change)
+{
+    if(change == PlantDB::SPECIE_REMOVED)
+    {
+        remove(specie_id);
+        return;
+    }
+
+    std::unique_ptr<SpecieProperties> specie (plant_db.getPlantData(specie_id));
+    if(specie)
+        update(*specie);
+    else
+        remove(specie_id); // Removed again since the notification
+}
+
+/**************
+ * EVALUATION *
+ **************/
+float SuitabilityTables::evaluate(std::size_t row, float illumination, float soil_humidity, float temperature, float slope) const
+{
+    float r (m_illumination[row * illumination_width + quantize(illumination, ILLUMINATION_DOMAIN_MIN, ILLUMINATION_DOMAIN_MAX)]);
+    r = std::min(r, m_soil_humidity[row * soil_humidity_width + quantize(soil_humidity, SOIL_HUMIDITY_DOMAIN_MIN, SOIL_HUMIDITY_DOMAIN_MAX)]);
+    r = std::min(r, m_temperature[row * temperature_width + quantize(temperature, TEMPERATURE_DOMAIN_MIN, TEMPERATURE_DOMAIN_MAX)]);
+    r = std::min(r, m_slope[row * slope_width + quantize_slope(slope)]);
+    return r;
+}
+
+void SuitabilityTables::evaluate(std::size_t row, const EnvironmentCells & cells, float * out) const
+{
+    for(std::size_t i (0); i < cells.count; i++)
+        out[i] = evaluate(row, cells.illumination[i], cells.soil_humidity[i], cells.temperature[i], cells.slope[i]);
+}
+
+/*
+ * The cells are quantized once, then every row is a pass of plain lookups.
+ */
+void SuitabilityTables::evaluate(const EnvironmentCells & cells, float * out) const
+{
+    std::vector<int> illumination (cells.count), soil_humidity (cells.count), temperature (cells.count), slope (cells.count);
+    for(std::size_t i (0); i < cells.count; i++)
+    {
+        illumination[i] = quantize(cells.illumination[i], ILLUMINATION_DOMAIN_MIN, ILLUMINATION_DOMAIN_MAX);
+        soil_humidity[i] = quantize(cells.soil_humidity[i], SOIL_HUMIDITY_DOMAIN_MIN, SOIL_HUMIDITY_DOMAIN_MAX);
+        temperature[i] = quantize(cells.temperature[i], TEMPERATURE_DOMAIN_MIN, TEMPERATURE_DOMAIN_MAX);
+        slope[i] = quantize_slope(cells.slope[i]);
+    }
+
+    for(std::size_t row (0); row < size(); row++)
+    {
+        const float * illumination_row (&m_illumination[row * illumination_width]);
+        const float * soil_humidity_row (&m_soil_humidity[row * soil_humidity_width]);
+        const float * temperature_row (&m_temperature[row * temperature_width]);
+        const float * slope_row (&m_slope[row * slope_width]);
+        float * row_out (out + row * cells.count);
+
+        for(std::size_t i (0); i < cells.count; i++)
+        {
+            float r (illumination_row[illumination[i]]);
+            r = std::min(r, soil_humidity_row[soil_humidity[i]]);
+            r = std::min(r, temperature_row[temperature[i]]);
+            r = std::min(r, slope_row[slope[i]]);
+            row_out[i] = r;
+        }
+    }
+}
+
+/******************
+ * HELPER METHODS *
+ ******************/
+void SuitabilityTables::build_row(std::size_t row, const SpecieProperties & specie)
+{
+    m_specie_ids[row] = specie.specie_id;
+
+    const IlluminationProperties & illumination (specie.illumination_properties);
+    for(int i (0); i < illumination_width - 1; i++)
+        m_illumination[row * illumination_width + i] =
+                SuitabilityKernel::response(ILLUMINATION_DOMAIN_MIN + i, illumination.min_illumination, illumination.prime_illumination.first,
+                                            illumination.prime_illumination.second, illumination.max_illumination);
+
+    const SoilHumidityProperties & soil_humidity (specie.soil_humidity_properties);
+    for(int i (0); i < soil_humidity_width - 1; i++)
+        m_soil_humidity[row * soil_humidity_width + i] =
+                SuitabilityKernel::response(SOIL_HUMIDITY_DOMAIN_MIN + i, soil_humidity.min_soil_humidity, soil_humidity.prime_soil_humidity.first,
+                                            soil_humidity.prime_soil_humidity.second, soil_humidity.max_soil_humidity);
+
+    const TemperatureProperties & temperature (specie.temperature_properties);
+    for(int i (0); i < temperature_width - 1; i++)
+        m_temperature[row * temperature_width + i] =
+                SuitabilityKernel::response(TEMPERATURE_DOMAIN_MIN + i, temperature.min_temp, temperature.prime_temp.first,
+                                            temperature.prime_temp.second, temperature.max_temp);
+
+    const SlopeProperties & slope (specie.slope_properties);
+    for(int i (0); i < slope_width - 1; i++)
+        m_slope[row * slope_width + i] = SuitabilityKernel::slopeResponse(SLOPE_DOMAIN_MIN + i, slope.start_of_decline, slope.max);
+
+    // Out of domain entries
+    m_illumination[row * illumination_width + illumination_width - 1] = 0;
+    m_soil_humidity[row * soil_humidity_width + soil_humidity_width - 1] = 0;
+    m_temperature[row * temperature_width + temperature_width - 1] = 0;
+    m_slope[row * slope_width + slope_width - 1] = 0;
+}
+
+void SuitabilityTables::copy_row(std::size_t from, std::size_t to)
+{
+    m_specie_ids[to] = m_specie_ids[from];
+    std::copy_n(&m_illumination[from * illumination_width], illumination_width, &m_illumination[to * illumination_width]);
+    std::copy_n(&m_soil_humidity[from * soil_humidity_width], soil_humidity_width, &m_soil_humidity[to * soil_humidity_width]);
+    std::copy_n(&m_temperature[from * temperature_width], temperature_width, &m_temperature[to * temperature_width]);
+    std::copy_n(&m_slope[from * slope_width], slope_width, &m_slope[to * slope_width]);
+}
+
+void SuitabilityTables::resize(std::size_t rows)
+{
+    m_specie_ids.resize(rows);
+    m_illumination.resize(rows * illumination_width);
+    m_soil_humidity.resize(rows * soil_humidity_width);
+    m_temperature.resize(rows * temperature_width);
+    m_slope.resize(rows * slope_width);
+}
@@ -0,0 +1,72 @@
+#ifndef SUITABILITY_TABLES_H
+#define SUITABILITY_TABLES_H
+
+#include "plant_db.h"
+#include "species_table.h"
+#include "suitability_kernel.h"
+
+#include <cstddef>
+#include <unordered_map>
+
+// Input domains, as accepted by the editor
+#define ILLUMINATION_DOMAIN_MIN 0 // hours per day
+#define ILLUMINATION_DOMAIN_MAX 24
+#define SOIL_HUMIDITY_DOMAIN_MIN 0
+#define SOIL_HUMIDITY_DOMAIN_MAX 1000
+#define TEMPERATURE_DOMAIN_MIN -50 // degrees celsius
+#define TEMPERATURE_DOMAIN_MAX 50
+#define SLOPE_DOMAIN_MIN 0 // degrees
+#define SLOPE_DOMAIN_MAX 90
+
+/*
+ * Per-specie responses to illumination, soil humidity, temperature and slope, tabulated for every integer
+ * value of their domain. Scoring a cell then costs four lookups instead of the range arithmetic of
+ * SuitabilityKernel, with the same results for integer inputs, provided the species envelopes lie within the
+ * domains (as the editor enforces).
+ *
+ * Inputs within their domain are rounded to the nearest integer. Inputs outside of it, and NaN, score 0 like
+ * they do with the kernel, except negative slopes which score like a flat one. Each factor is a table with one
+ * row per specie (about 4.9 KB per specie in total); rows are addressed by a dense index, see index().
+ *
+ * Tables follow changes to the species through update() and remove(), which only rebuild the rows
+ * concerned. apply() does so from a PlantDB change notification:
+ *
+ *     plant_db.subscribe([&](int id, PlantDB::ChangeType change) { tables.apply(plant_db, id, change); });
+ */
+class SuitabilityTables {
+public:
+    SuitabilityTables();
+    explicit SuitabilityTables(const PlantDB::SpeciePropertiesHolder & species);
+    explicit SuitabilityTables(PlantDB & plant_db);
+
+    std::size_t size() const;
+    int index(int specie_id) const; // Row of the specie, -1 if it is not tabulated
+    int specieId(std::size_t row) const;
+    std::size_t memoryUsage() const; // Bytes used by the tables
+
+    void update(const SpecieProperties & specie); // Adds the specie or rebuilds its rows
+    void remove(int specie_id); // The last row moves to the removed one
+    void apply(PlantDB & plant_db, int specie_id, PlantDB::ChangeType change);
+
+    float evaluate(std::size_t row, float illumination, float soil_humidity, float temperature, float slope) const;
+
+    // Suitability of every cell for the specie in the given row, written to out[0..cells.count)
+    void evaluate(std::size_t row, const EnvironmentCells & cells, float * out) const;
+
+    // Suitability of every cell for every specie, written species-major: out[row * cells.count + cell]
+    void evaluate(const EnvironmentCells & cells, float * out) const;
+
+private:
+    void build_row(std::size_t row, const SpecieProperties & specie);
+    void copy_row(std::size_t from, std::size_t to);
+    void resize(std::size_t rows);
+
+    SpeciesTable::Column<int32_t> m_specie_ids;
+    SpeciesTable::Column<float> m_illumination;
+    SpeciesTable::Column<float> m_soil_humidity;
+    SpeciesTable::Column<float> m_temperature;
+    SpeciesTable::Column<float> m_slope;
+    std::unordered_map<int, int> m_specie_id_to_row;
+};
+
+#endif // SUITABILITY_TABLES_H
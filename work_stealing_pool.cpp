@@ -0,0 +1,118 @@
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(int threads) :
+    m_task(NULL), m_remaining_tasks(0), m_batch(0), m_stop(false)
+{
+    if(threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for(int i (0); i < threads; i++)
+        m_queues.push_back(std::unique_ptr<TaskQueue>(new TaskQueue));
+
+    for(int i (0); i < threads; i++)
+        m_threads.push_back(std::thread(&WorkStealingPool::work, this, i));
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_batch_started.notify_all();
+
+    for(auto it (m_threads.begin()); it != m_threads.end(); it++)
+        it->join();
+}
+
+int WorkStealingPool::threadCount() const
+{
+    return m_threads.size();
+}
+
+void WorkStealingPool::run(std::size_t task_count, const Task & task)
+{
+    if(task_count == 0)
+        return;
+
+    std::lock_guard<std::mutex> run_lock(m_run_mutex);
+
+    m_task = &task;
+    m_remaining_tasks = task_count;
+
+    // Worker i gets the i-th contiguous range of tasks
+    std::size_t worker_count (m_queues.size());
+    for(std::size_t i (0); i < worker_count; i++)
+    {
+        std::lock_guard<std::mutex> lock(m_queues[i]->mutex);
+        for(std::size_t t (task_count * i / worker_count); t < task_count * (i + 1) / worker_count; t++)
+            m_queues[i]->tasks.push_back(t);
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_batch++;
+    m_batch_started.notify_all();
+    m_batch_done.wait(lock, [this]() { return m_remaining_tasks == 0; });
+    m_task = NULL;
+}
+
+void WorkStealingPool::work(int worker)
+{
+    long batch (0);
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_batch_started.wait(lock, [this, batch]() { return m_stop || m_batch != batch; });
+            if(m_stop)
+                return;
+            batch = m_batch;
+        }
+
+        std::size_t task;
+        while(next_task(worker, task))
+        {
+            (*m_task)(task);
+            if(--m_remaining_tasks == 0)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_batch_done.notify_all();
+            }
+        }
+    }
+}
+
+/*
+ * Own tasks are taken from the front of the queue, stolen ones from the back of the victim's queue:
+ * the owner and the thief work from opposite ends of the range.
+ */
+bool WorkStealingPool::next_task(int worker, std::size_t & task)
+{
+    {
+        TaskQueue & own (*m_queues[worker]);
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(!own.tasks.empty())
+        {
+            task = own.tasks.front();
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+
+    std::size_t worker_count (m_queues.size());
+    for(std::size_t i (1); i < worker_count; i++)
+    {
+        TaskQueue & victim (*m_queues[(worker + i) % worker_count]);
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(!victim.tasks.empty())
+        {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
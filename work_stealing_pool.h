@@ -0,0 +1,59 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Fixed set of worker threads running batches of independent tasks.
+ *
+ * run() deals the tasks of a batch out to the workers in contiguous ranges, so that neighbouring tasks
+ * (which usually share input data) run on the same thread. A worker that runs out of tasks steals from
+ * the far end of another worker's range, which keeps every thread busy when tasks have uneven costs.
+ */
+class WorkStealingPool {
+public:
+    typedef std::function<void(std::size_t task)> Task;
+
+    WorkStealingPool(int threads = 0); // 0: one thread per hardware thread
+    ~WorkStealingPool();
+
+    int threadCount() const;
+
+    // Runs task(0) ... task(task_count - 1) across the workers and waits for all of them to complete
+    void run(std::size_t task_count, const Task & task);
+
+private:
+    WorkStealingPool(const WorkStealingPool & other);
+    WorkStealingPool & operator=(const WorkStealingPool & other);
+
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+    };
+
+    void work(int worker);
+    bool next_task(int worker, std::size_t & task);
+
+    std::vector<std::unique_ptr<TaskQueue> > m_queues; // One per worker
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_run_mutex; // One batch at a time
+    const Task * m_task; // Task of the current batch
+    std::atomic<std::size_t> m_remaining_tasks;
+
+    std::mutex m_mutex;
+    std::condition_variable m_batch_started;
+    std::condition_variable m_batch_done;
+    long m_batch;
+    bool m_stop;
+};
+
+#endif // WORK_STEALING_POOL_H